@@ -0,0 +1,77 @@
+#ifndef _PPK_BENCH_HPP
+#define _PPK_BENCH_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+
+namespace bench
+{
+
+// Text of a tree like our data files: groups of scalars of all kinds, lists and subgroups.
+inline std::string makeData(size_t groups)
+{
+	std::string text;
+	for (size_t i = 0; i < groups; i++)
+	{
+		std::string n = std::to_string(i);
+		text += "Tree t" + n + " {\n";
+		text += "\tvar = " + std::to_string(i * 0.37) + "\n";
+		text += "\tvar w = \"some text " + n + "\"\n";
+		text += "\tcount = " + std::to_string(i * 7919 % 100003) + "\n";
+		text += "\tenabled = " + std::string(i % 2 ? "true" : "false") + "\n";
+		text += "\tlist = " + n + ", " + std::to_string(2 * i) + ", " + std::to_string(3 * i) + ", [a, b, \"c d\"]\n";
+		text += "\tsub { x = 0x" + n + " y = inf }\n";
+		text += "}\n";
+	}
+	return text;
+}
+
+// Size of data given as the first argument, or the default one
+inline size_t getSize(int argc, char ** argv, size_t default_size)
+{
+	return argc > 1 ? std::strtoul(argv[1], NULL, 10) : default_size;
+}
+
+inline bool writeFile(const std::string & path, const std::string & contents)
+{
+	std::ofstream file(path, std::ios::binary);
+	file << contents;
+	return bool(file);
+}
+
+inline uint64_t fileSize(const std::string & path)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	return file ? uint64_t(file.tellg()) : 0;
+}
+
+// Best time of a few runs of the function, in milliseconds
+template <class F>
+double measure(F function, int runs = 3)
+{
+	double best = 0;
+	for (int i = 0; i < runs; i++)
+	{
+		auto begin = std::chrono::steady_clock::now();
+		function();
+		std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - begin;
+		best = i ? std::min(best, time.count()) : time.count();
+	}
+	return best;
+}
+
+inline int fail(const std::string & message)
+{
+	std::cerr << "FAILED: " << message << "\n";
+	return 1;
+}
+
+}
+
+#endif //_PPK_BENCH_HPP
@@ -0,0 +1,51 @@
+// Compares reading the same tree from text and from the binary format.
+
+#include <cstdio>
+
+#include "FS.hpp"
+#include "bench.hpp"
+
+using namespace ppk;
+
+int main(int argc, char ** argv)
+{
+	std::string text_path = "bench_binary.cl", binary_path = "bench_binary.bin";
+	if (!bench::writeFile(text_path, bench::makeData(bench::getSize(argc, argv, 200000))))
+		return bench::fail("can't write " + text_path);
+
+	FS fs;
+	if (!fs.read(text_path) || !fs.writeBinary(binary_path))
+		return bench::fail(fs.getError());
+
+	std::string text_error, binary_error;
+	double text_time = bench::measure([&]()
+	{
+		FS text;
+		if (!text.read(text_path))
+			text_error = text.getError();
+	});
+	double binary_time = bench::measure([&]()
+	{
+		FS binary;
+		if (!binary.readBinary(binary_path))
+			binary_error = binary.getError();
+	});
+	if (!text_error.empty() || !binary_error.empty())
+		return bench::fail(text_error + binary_error);
+
+	FS binary;
+	binary.readBinary(binary_path);
+	uint64_t text_size = bench::fileSize(text_path), binary_size = bench::fileSize(binary_path);
+	std::string expected, result;
+	fs.writeString(expected);
+	binary.writeString(result);
+	std::remove(text_path.c_str());
+	std::remove(binary_path.c_str());
+	if (result != expected)
+		return bench::fail("the binary file was read differently than the text one");
+
+	std::cout << "text:   " << text_size << " bytes, " << text_time << " ms\n"
+	          << "binary: " << binary_size << " bytes, " << binary_time << " ms ("
+	          << text_time / binary_time << "x faster)\n";
+	return 0;
+}
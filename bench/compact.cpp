@@ -0,0 +1,65 @@
+// Writes trees as pretty and compact text, reads both back and checks that they give the same trees.
+
+#include "FS.hpp"
+#include "bench.hpp"
+
+using namespace ppk;
+
+namespace
+{
+
+// Every kind of node, with names and scalars which need quoting and escaping
+const char * const special =
+	"null1;\n"
+	"null2 {}\n"
+	"null3 = {}\n"
+	"null4 = []\n"
+	"a-bool = true\n"
+	"hexadecimal_int optional-id = 0xff00ff\n"
+	"\"iee 754 stuff\" some_name = -inf\n"
+	"some_string = \"Bwahahahahahah\\t\\t\\t\\n\\n \\\\ \\\"!@#$%^&\\\"\"\n"
+	"a_vector = 200, 400\n"
+	"big_list = a, true, 42, 0.2, [a, b, c], {var = x   var = y   another_var = z}, [], {}\n"
+	"'also list' = [123, 233, 655]\n"
+	"Tree larch { var = 3  var = 7  var with_identifier = 4  nested { deeper { list = [[1, 2], [3]] } } }\n";
+
+int roundTrip(const std::string & name, const std::string & text)
+{
+	FS fs;
+	if (!fs.readString(text, name))
+		return bench::fail(fs.getError());
+
+	std::string pretty, compact;
+	fs.writeString(pretty);
+	fs.setCompact(true);
+	fs.writeString(compact);
+
+	FS from_pretty, from_compact;
+	if (!from_pretty.readString(pretty, name + " (pretty)"))
+		return bench::fail(from_pretty.getError());
+	if (!from_compact.readString(compact, name + " (compact)"))
+		return bench::fail(from_compact.getError());
+
+	// Trees are compared through their pretty text, and the compact one must be written again the same.
+	std::string pretty_again, compact_pretty, compact_again;
+	from_pretty.writeString(pretty_again);
+	from_compact.writeString(compact_pretty);
+	from_compact.setCompact(true);
+	from_compact.writeString(compact_again);
+	if (pretty_again != pretty || compact_pretty != pretty || compact_again != compact)
+		return bench::fail(name + " was read back differently");
+	if (compact.size() >= pretty.size())
+		return bench::fail(name + " isn't smaller in compact text");
+
+	std::cout << name << ":  pretty " << pretty.size() << " bytes  compact " << compact.size() << " bytes ("
+	          << 100.0 * compact.size() / pretty.size() << "%)\n";
+	return 0;
+}
+
+}
+
+int main(int argc, char ** argv)
+{
+	return roundTrip("special nodes", special)
+	    || roundTrip("groups", bench::makeData(bench::getSize(argc, argv, 100000)));
+}
@@ -0,0 +1,169 @@
+// Compares the standard converters with conversions through std::stringstream, which they replaced.
+
+#include <cmath>
+#include <deque>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <type_traits>
+#include <vector>
+
+#include "Node.hpp"
+#include "StandardConverters.hpp"
+#include "bench.hpp"
+
+using namespace ppk;
+
+namespace
+{
+
+// The converters as they were, apart from the special floating-point values
+template <class T>
+struct StreamConverter
+{
+	static bool fromString(const std::string & str, T & out)
+	{
+		std::stringstream stream(str);
+		stream.unsetf(std::ios::dec);
+		stream >> std::noskipws >> std::boolalpha >> out;
+		stream.peek();
+		return stream.eof();
+	}
+
+	static void toNode(Node & node, const T & in)
+	{
+		std::stringstream stream;
+		stream << std::boolalpha << in;
+		node.setScalar(stream.str());
+	}
+};
+
+template <class T>
+bool same(const T & a, const T & b)
+{
+	return a == b || (a != a && b != b);
+}
+
+// Texts of numbers as they are written in files, in every syntax both conversions accept
+template <class T>
+std::string makeText(std::mt19937_64 & random, std::true_type /* floating point */)
+{
+	char text[64];
+	switch (random() % 4)
+	{
+	case 0:
+		snprintf(text, sizeof(text), "%d", int(random() % 2001) - 1000);
+		break;
+	case 1:
+		snprintf(text, sizeof(text), "%.17g", double(random() % 1000000) / 997);
+		break;
+	default:
+		snprintf(text, sizeof(text), "%g", std::ldexp(double(random() % 1000000) - 500000, int(random() % 200) - 100));
+	}
+	return text;
+}
+
+template <class T>
+std::string makeText(std::mt19937_64 & random, std::false_type /* integer */)
+{
+	if (std::is_same<T, bool>::value)
+		return random() % 2 ? "true" : "false";
+	if (sizeof(T) == 1)
+		return std::string(1, char('a' + random() % 26));
+
+	uint64_t max = std::numeric_limits<T>::max();
+	uint64_t value = random() % max;
+	bool negative = std::numeric_limits<T>::is_signed && random() % 2;
+	char text[64];
+	switch (random() % 4)
+	{
+	case 0:
+		snprintf(text, sizeof(text), "0x%llx", static_cast<unsigned long long>(value));
+		break;
+	case 1:
+		snprintf(text, sizeof(text), "0%llo", static_cast<unsigned long long>(value));
+		break;
+	default:
+		snprintf(text, sizeof(text), "%s%llu", negative ? "-" : "", static_cast<unsigned long long>(value));
+	}
+	return text;
+}
+
+template <class T>
+int compare(const char * name, size_t count)
+{
+	std::mt19937_64 random(count);
+	std::vector<std::string> texts;
+	for (size_t i = 0; i < count; i++)
+		texts.push_back(makeText<T>(random, std::is_floating_point<T>()));
+
+	std::deque<T> values(count), old_values(count);  // std::vector<bool> has no references to elements
+	bool parsed = true, old_parsed = true;
+	double parse_time = bench::measure([&]()
+	{
+		for (size_t i = 0; i < count; i++)
+			parsed &= Converter<T>::fromString(texts[i], values[i]);
+	});
+	double old_parse_time = bench::measure([&]()
+	{
+		for (size_t i = 0; i < count; i++)
+			old_parsed &= StreamConverter<T>::fromString(texts[i], old_values[i]);
+	});
+	if (!parsed || !old_parsed)
+		return bench::fail(std::string(name) + " texts weren't parsed");
+	for (size_t i = 0; i < count; i++)
+		if (!same(values[i], old_values[i]))
+			return bench::fail(std::string(name) + " text " + texts[i] + " was parsed differently");
+
+	Node node, old_node;
+	std::string texts_written, old_texts_written;
+	double format_time = bench::measure([&]()
+	{
+		texts_written.clear();
+		for (auto & value : values)
+		{
+			Converter<T>::toNode(node, value);
+			texts_written += node.getScalar();
+		}
+	});
+	double old_format_time = bench::measure([&]()
+	{
+		old_texts_written.clear();
+		for (auto & value : values)
+		{
+			StreamConverter<T>::toNode(old_node, value);
+			old_texts_written += old_node.getScalar();
+		}
+	});
+	if (texts_written != old_texts_written)
+		return bench::fail(std::string(name) + " values were written differently");
+
+	double scale = 1e6 / count;
+	std::cout << name << ", ns per conversion (converter / stringstream):  parse "
+	          << parse_time * scale << " / " << old_parse_time * scale
+	          << "  format " << format_time * scale << " / " << old_format_time * scale << "\n";
+	return 0;
+}
+
+}
+
+int main(int argc, char ** argv)
+{
+	size_t count = bench::getSize(argc, argv, 1000000);
+	return compare<bool>("bool", count)
+	    || compare<int>("int", count)
+	    || compare<short>("short", count)
+	    || compare<long>("long", count)
+	    || compare<long long>("long long", count)
+	    || compare<unsigned>("unsigned", count)
+	    || compare<unsigned short>("unsigned short", count)
+	    || compare<unsigned long>("unsigned long", count)
+	    || compare<unsigned long long>("unsigned long long", count)
+	    || compare<char>("char", count)
+	    || compare<signed char>("signed char", count)
+	    || compare<unsigned char>("unsigned char", count)
+	    || compare<float>("float", count)
+	    || compare<double>("double", count)
+	    || compare<long double>("long double", count);
+}
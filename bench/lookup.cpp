@@ -0,0 +1,107 @@
+// Compares looking up children by name in the index of Node with the std::multimap it used before.
+
+#include <iterator>
+#include <map>
+#include <vector>
+
+#include "FS.hpp"
+#include "bench.hpp"
+
+using namespace ppk;
+
+namespace
+{
+
+typedef std::multimap<std::string, const Node *> OldIndex;
+
+// Group with given number of children, each name used by four of them
+std::string makeGroup(size_t children)
+{
+	std::string text = "group {\n";
+	for (size_t i = 0; i < children; i++)
+		text += "\tname_" + std::to_string(i * 7919 % (children / 4 + 1)) + " = " + std::to_string(i) + "\n";
+	return text + "}\n";
+}
+
+// Names of existing children in mixed order, then the same number of missing ones
+std::vector<std::string> makeKeys(size_t children, size_t count)
+{
+	std::vector<std::string> keys;
+	for (size_t i = 0; i < count; i++)
+		keys.push_back("name_" + std::to_string(i * 104729 % (children / 4 + 1)));
+	for (size_t i = 0; i < count; i++)
+		keys.push_back("missing_" + std::to_string(i % 1000));
+	return keys;
+}
+
+int compare(size_t children, size_t lookups)
+{
+	FS fs;
+	if (!fs.readString(makeGroup(children)))
+		return bench::fail(fs.getError());
+
+	const Node & group = fs.getRoot()["group"];
+	OldIndex old_index;
+	for (auto & child : group.all())
+		old_index.insert(std::make_pair(child.getName(), &child));
+
+	std::vector<std::string> keys = makeKeys(children, lookups / 2);
+	auto present = keys.begin() + lookups / 2;
+	uint64_t new_sum = 0, old_sum = 0;
+
+	double new_last = bench::measure([&]()
+	{
+		for (auto it = keys.begin(); it != present; ++it)
+			new_sum += reinterpret_cast<uintptr_t>(&group[*it]);
+	});
+	double old_last = bench::measure([&]()
+	{
+		for (auto it = keys.begin(); it != present; ++it)
+			old_sum += reinterpret_cast<uintptr_t>(std::prev(old_index.upper_bound(*it))->second);
+	});
+
+	double new_count = bench::measure([&]()
+	{
+		for (auto & key : keys)
+			new_sum += group.count(key) + group.hasKey(key);
+	});
+	double old_count = bench::measure([&]()
+	{
+		for (auto & key : keys)
+			old_sum += old_index.count(key) + (old_index.find(key) != old_index.end());
+	});
+
+	double new_only = bench::measure([&]()
+	{
+		for (auto & key : keys)
+			for (auto & child : group.only(key))
+				new_sum += reinterpret_cast<uintptr_t>(&child);
+	});
+	double old_only = bench::measure([&]()
+	{
+		for (auto & key : keys)
+			for (auto range = old_index.equal_range(key); range.first != range.second; ++range.first)
+				old_sum += reinterpret_cast<uintptr_t>(range.first->second);
+	});
+
+	if (new_sum != old_sum)
+		return bench::fail("the index found other children than std::multimap");
+
+	double scale = 1e6 / lookups;
+	std::cout << children << " children, ns per lookup (index / std::multimap):"
+	          << "  operator[] " << 2 * new_last * scale << " / " << 2 * old_last * scale
+	          << "  count+hasKey " << new_count * scale << " / " << old_count * scale
+	          << "  only " << new_only * scale << " / " << old_only * scale << "\n";
+	return 0;
+}
+
+}
+
+int main(int argc, char ** argv)
+{
+	size_t size = bench::getSize(argc, argv, 100000);
+	for (size_t children : {size_t(8), size_t(64), size_t(1024), size})
+		if (children <= size && compare(children, 20 * size) != 0)
+			return 1;
+	return 0;
+}
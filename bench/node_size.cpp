@@ -0,0 +1,145 @@
+// Reports how much memory read trees take per node. Everything allocated while a tree is read is counted:
+// nodes with unused space of their pools, lists of children, scalars and interned names.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+#include "FS.hpp"
+#include "bench.hpp"
+
+using namespace ppk;
+
+namespace
+{
+
+// Size of each allocation is kept before it, so that it can be subtracted when it is freed.
+const size_t header_size = alignof(std::max_align_t);
+std::atomic<int64_t> allocated(0);
+
+size_t countNodes(const Node & node)
+{
+	size_t count = 1;
+	for (auto & child : node.all())
+		count += countNodes(child);
+	return count;
+}
+
+// Bytes allocated by FS which read the file, with given options
+int64_t measureTree(const std::string & path, const std::function<void(FS &)> & configure, std::string & error)
+{
+	int64_t before = allocated;
+	std::unique_ptr<FS> fs(new FS());
+	configure(*fs);
+	if (!fs->read(path))
+		error = fs->getError();
+	return allocated - before;
+}
+
+int report(const std::string & name, const std::string & text)
+{
+	std::string path = "bench_node_size.cl";
+	if (!bench::writeFile(path, text))
+		return bench::fail("can't write " + path);
+
+	FS fs;
+	if (!fs.read(path))
+		return bench::fail(fs.getError());
+	size_t nodes = countNodes(fs.getRoot());
+
+	std::string error;
+	double plain = double(measureTree(path, [](FS &) {}, error)) / nodes;
+	double zero_copy = double(measureTree(path, [](FS & fs) { fs.setZeroCopy(true); }, error)) / nodes;
+	double packed = double(measureTree(path, [](FS & fs) { fs.setPackedLists(true); }, error)) / nodes;
+	std::remove(path.c_str());
+	if (!error.empty())
+		return bench::fail(error);
+	if (plain < sizeof(Node))
+		return bench::fail("allocations weren't counted");
+
+	std::cout << name << ", " << nodes << " nodes, bytes per node:  copied scalars " << plain
+	          << "  zero-copy (without the mapped file) " << zero_copy << "  packed lists " << packed << "\n";
+	return 0;
+}
+
+}
+
+// All replaceable forms are replaced, as the library may free blocks allocated by any of them.
+void * operator new(size_t size, const std::nothrow_t &) noexcept
+{
+	void * block = std::malloc(header_size + size);
+	if (!block)
+		return NULL;
+
+	*static_cast<size_t *>(block) = size;
+	allocated += size;
+	return static_cast<char *>(block) + header_size;
+}
+
+void * operator new(size_t size)
+{
+	void * pointer = operator new(size, std::nothrow);
+	if (!pointer)
+		throw std::bad_alloc();
+	return pointer;
+}
+
+void * operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void * operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+	return operator new(size, std::nothrow);
+}
+
+void operator delete(void * pointer) noexcept
+{
+	if (!pointer)
+		return;
+
+	char * block = static_cast<char *>(pointer) - header_size;
+	allocated -= *reinterpret_cast<size_t *>(block);
+	std::free(block);
+}
+
+void operator delete(void * pointer, size_t) noexcept
+{
+	operator delete(pointer);
+}
+
+void operator delete(void * pointer, const std::nothrow_t &) noexcept
+{
+	operator delete(pointer);
+}
+
+void operator delete[](void * pointer) noexcept
+{
+	operator delete(pointer);
+}
+
+void operator delete[](void * pointer, size_t) noexcept
+{
+	operator delete(pointer);
+}
+
+void operator delete[](void * pointer, const std::nothrow_t &) noexcept
+{
+	operator delete(pointer);
+}
+
+int main(int argc, char ** argv)
+{
+	size_t size = bench::getSize(argc, argv, 1000000);
+	std::string numbers = "numbers = 0";
+	for (size_t i = 1; i < size; i++)
+		numbers += ", " + std::to_string(i * 7);
+
+	std::cout << "sizeof(Node) " << sizeof(Node) << ", sizeof(Children) " << sizeof(detail::Children) << "\n";
+	return report("groups", bench::makeData(size / 8))
+	    || report("list of numbers", numbers + "\n");
+}
@@ -0,0 +1,86 @@
+// Writes nodes with StreamWriter, reads them back and checks that FS writes the same text.
+
+#include "FS.hpp"
+#include "StandardConverters.hpp"
+#include "StreamWriter.hpp"
+#include "bench.hpp"
+
+using namespace ppk;
+
+namespace
+{
+
+// Every kind of node, including empty groups and lists at every level
+void writeNodes(StreamWriter & writer, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		std::string n = std::to_string(i);
+		writer.value("int" + n, int(i));
+		writer.value("string", n, std::string("text with \"quotes\",\tspaces\nand lines"));
+		writer.beginGroup("empty_group" + n);
+		writer.end();
+		writer.beginList("empty_list", n);
+		writer.end();
+
+		writer.beginList("list" + n);
+		writer.value(1);
+		writer.value(2.5);
+		writer.beginList();
+		writer.end();
+		writer.beginList();
+		writer.value(std::string("x y"));
+		writer.beginList();
+		writer.end();
+		writer.end();
+		writer.beginGroup();
+		writer.end();
+		writer.beginGroup();
+		writer.value("flag", true);
+		writer.beginList("inner");
+		writer.end();
+		writer.end();
+		writer.end();
+
+		writer.beginGroup("Tree", "larch" + n);
+		writer.value("var", 3u);
+		writer.beginGroup("sub");
+		writer.beginList("l");
+		writer.end();
+		writer.beginGroup("g");
+		writer.end();
+		writer.end();
+		writer.end();
+	}
+}
+
+int check(bool compact, size_t count)
+{
+	std::string streamed;
+	{
+		StreamWriter writer(streamed);
+		writer.setCompact(compact);
+		writeNodes(writer, count);
+		if (!writer.close())
+			return bench::fail(writer.getError());
+	}
+
+	FS fs;
+	if (!fs.readString(streamed))
+		return bench::fail(fs.getError());
+
+	std::string written;
+	fs.setCompact(compact);
+	fs.writeString(written);
+	if (written != streamed)
+		return bench::fail(std::string(compact ? "compact" : "pretty") + " text of StreamWriter differs from FS::write()");
+	return 0;
+}
+
+}
+
+int main(int argc, char ** argv)
+{
+	size_t count = bench::getSize(argc, argv, 1000);
+	return check(false, count) || check(true, count);
+}
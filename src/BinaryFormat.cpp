@@ -0,0 +1,263 @@
+#include "BinaryFormat.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "Node.hpp"
+#include "NodePool.hpp"
+#include "StringTable.hpp"
+
+using namespace ppk;
+using namespace ppk::detail;
+
+namespace
+{
+const char magic[] = {'P', 'P', 'K', 'B'};
+const unsigned char version = 1;
+const unsigned char identifier_flag = 4;
+const size_t buffer_size = 1 << 20;
+}
+
+BinaryWriter::BinaryWriter(FILE * file) :
+    file(file),
+    failed(false)
+{
+	intern("");
+}
+
+bool BinaryWriter::write(const Node & root)
+{
+	collect(root);
+
+	buffer.reserve(buffer_size + 4096);
+	buffer.append(magic, sizeof(magic));
+	putByte(version);
+
+	putNumber(table.size());
+	for (auto & str : table)
+	{
+		putString(*str);
+		flush();
+	}
+
+	putNumber(root.size());
+	for (auto & child : root.all())
+	{
+		writeNode(child);
+		flush();
+	}
+
+	flush(true);
+	return !failed;
+}
+
+void BinaryWriter::collect(const Node & node)
+{
+	intern(node.getName());
+	intern(node.getIdentifier());
+
+	for (auto & child : node.all())
+		collect(child);
+}
+
+uint64_t BinaryWriter::intern(const std::string & str)
+{
+	auto it = strings.find(str);
+	if (it != strings.end())
+		return it->second;
+
+	it = strings.insert(std::make_pair(str, table.size())).first;
+	table.push_back(&it->first);
+	return it->second;
+}
+
+void BinaryWriter::writeNode(const Node & node)
+{
+	unsigned char flags = static_cast<unsigned char>(node.getType());
+	if (node.hasIdentifier())
+		flags |= identifier_flag;
+
+	putByte(flags);
+	putNumber(strings.find(node.getName())->second);
+	if (node.hasIdentifier())
+		putNumber(strings.find(node.getIdentifier())->second);
+
+	switch (node.getType())
+	{
+	case Node::Type::Null:
+		break;
+	case Node::Type::Scalar:
+		putString(node.getScalar());
+		break;
+	case Node::Type::List:
+	case Node::Type::Group:
+		putNumber(node.size());
+		for (auto & child : node.all())
+		{
+			writeNode(child);
+			flush();
+		}
+		break;
+	}
+}
+
+void BinaryWriter::putByte(unsigned char byte)
+{
+	buffer += static_cast<char>(byte);
+}
+
+void BinaryWriter::putNumber(uint64_t number)
+{
+	while (number >= 0x80)
+	{
+		putByte(static_cast<unsigned char>(number) | 0x80);
+		number >>= 7;
+	}
+	putByte(static_cast<unsigned char>(number));
+}
+
+void BinaryWriter::putString(const StringRef & str)
+{
+	putNumber(str.size());
+	buffer.append(str.data(), str.size());
+}
+
+void BinaryWriter::flush(bool force)
+{
+	if (buffer.size() < buffer_size && !force)
+		return;
+
+	if (fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+		failed = true;
+	buffer.clear();
+}
+
+
+BinaryReader::BinaryReader(const char * data, size_t size, NodePool & pool, StringTable & table) :
+    current(data),
+    end(data + size),
+    pool(pool),
+    table(table)
+{
+}
+
+bool BinaryReader::read(Node & owner)
+{
+	if (end - current < static_cast<ptrdiff_t>(sizeof(magic) + 1)
+	    || memcmp(current, magic, sizeof(magic)) != 0
+	    || static_cast<unsigned char>(current[sizeof(magic)]) != version)
+		return false;
+	current += sizeof(magic) + 1;
+
+	uint64_t count;
+	if (!getNumber(count) || count == 0 || count > static_cast<uint64_t>(end - current) + 1)
+		return false;
+
+	strings.resize(count);
+	for (auto & str : strings)
+	{
+		const char * data;
+		size_t size;
+		if (!getString(data, size))
+			return false;
+		str = table.intern(StringRef(data, size));
+	}
+
+	if (!strings[0]->str.empty())
+		return false;
+
+	try {
+		return readChildren(owner) && current == end;
+	}
+	catch (const std::domain_error &)
+	{
+		return false;  // Named children of lists and so on
+	}
+}
+
+bool BinaryReader::readNode(Node & parent)
+{
+	if (current == end)
+		return false;
+
+	unsigned char flags = *current++;
+	if (flags & ~(identifier_flag | 3))
+		return false;
+
+	uint64_t name, identifier = 0;
+	if (!getNumber(name) || name >= strings.size())
+		return false;
+	if ((flags & identifier_flag) && (!getNumber(identifier) || identifier >= strings.size()))
+		return false;
+
+	Node * node = pool.create(strings[name], strings[identifier]);
+	parent.append(node);
+
+	switch (static_cast<Node::Type>(flags & 3))
+	{
+	case Node::Type::Null:
+		return true;
+	case Node::Type::Scalar:
+	{
+		const char * data;
+		size_t size;
+		if (!getString(data, size))
+			return false;
+		node->assignScalar(StringRef(data, size), true);
+		return true;
+	}
+	case Node::Type::List:
+	case Node::Type::Group:
+		return readChildren(*node);
+	}
+
+	return false;
+}
+
+bool BinaryReader::readChildren(Node & owner)
+{
+	uint64_t count;
+	if (!getNumber(count) || count > static_cast<uint64_t>(end - current))
+		return false;
+
+	owner.makeChildren().block_index.reserve(owner.children->block_index.size() + count);
+	bool result = true;
+	try {
+		for (uint64_t i = 0; i < count && result; i++)
+			result = readNode(owner);
+	}
+	catch (const std::domain_error &)
+	{
+		owner.indexChildren();
+		throw;
+	}
+
+	owner.indexChildren();
+	return result;
+}
+
+bool BinaryReader::getNumber(uint64_t & number)
+{
+	number = 0;
+	for (unsigned shift = 0; current != end && shift < 64; shift += 7)
+	{
+		unsigned char byte = *current++;
+		number |= static_cast<uint64_t>(byte & 0x7f) << shift;
+		if (!(byte & 0x80))
+			return true;
+	}
+
+	return false;
+}
+
+bool BinaryReader::getString(const char * & data, size_t & size)
+{
+	uint64_t length;
+	if (!getNumber(length) || length > static_cast<uint64_t>(end - current))
+		return false;
+
+	data = current;
+	size = length;
+	current += length;
+	return true;
+}
@@ -0,0 +1,97 @@
+#ifndef _PPK_BINARYFORMAT_HPP
+#define _PPK_BINARYFORMAT_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "StringRef.hpp"
+
+
+namespace ppk
+{
+
+class Node;
+
+namespace detail
+{
+
+class NodePool;
+class StringTable;
+struct InternedString;
+
+/*
+ * Binary format of FS::writeBinary():
+ *
+ *   "PPKB" version:u8
+ *   string count:varint, then each string: length:varint bytes
+ *   root children count:varint, then each child as node
+ *
+ * node:
+ *   flags:u8 -- type in lower two bits, 4 if it has identifier
+ *   name:varint -- index in strings, 0 is always the empty string
+ *   identifier:varint -- only if flagged
+ *   Scalar: length:varint bytes
+ *   List, Group: children count:varint, then each child as node
+ *
+ * Names and identifiers are stored only once, in the string table.
+ */
+
+// Writes nodes in binary format through a buffer.
+class BinaryWriter
+{
+public:
+	BinaryWriter(FILE * file);
+
+	// Returns false if writing failed
+	bool write(const Node & root);
+
+private:
+	FILE * file;
+	std::string buffer;
+	bool failed;
+	std::unordered_map<std::string, uint64_t> strings;
+	std::vector<const std::string *> table;
+
+	void collect(const Node & node);
+	uint64_t intern(const std::string & str);
+	void writeNode(const Node & node);
+
+	void putByte(unsigned char byte);
+	void putNumber(uint64_t number);
+	void putString(const StringRef & str);
+	void flush(bool force = false);  // Writes the buffer if it is big enough
+};
+
+
+// Reads nodes written by BinaryWriter, creating them in the pool and adding them to the owner.
+// Their names and identifiers are interned in the table.
+class BinaryReader
+{
+public:
+	BinaryReader(const char * data, size_t size, NodePool & pool, StringTable & table);
+
+	// Returns false if data is corrupted. Nodes read so far are left in the owner.
+	bool read(Node & owner);
+
+private:
+	const char * current;
+	const char * end;
+	std::vector<const InternedString *> strings;
+	NodePool & pool;
+	StringTable & table;
+
+	bool readNode(Node & parent);
+	bool readChildren(Node & owner);
+
+	bool getNumber(uint64_t & number);
+	bool getString(const char * & data, size_t & size);
+};
+
+}
+}
+
+
+#endif //_PPK_BINARYFORMAT_HPP
@@ -1,25 +1,263 @@
 #include "FS.hpp"
 
 #include <boost/filesystem.hpp>
-#include <fstream>
+#include <ctime>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "utility.hpp"
+#include "BinaryFormat.hpp"
 #include "IFileIterator.hpp"
+#include "LazyBody.hpp"
+#include "MappedFile.hpp"
+#include "NodePool.hpp"
+#include "PackedList.hpp"
+#include "Scanner.hpp"
+#include "StringTable.hpp"
+#include "TextWriter.hpp"
+#include "TreeBuilder.hpp"
+#include "TreeLayout.hpp"
 
 using namespace boost::filesystem;
 using namespace ppk;
 using namespace ppk::detail;
 
+namespace
+{
+
+// Files smaller than two parts are not split
+const size_t min_part_size = 1 << 20;
+
+// Seconds after the modification time of a file during which it could still be modified without changing it
+const std::time_t modification_margin = 2;
+
+}
+
 FS::FS() :
-    root("<root>")
+    FS(std::make_shared<StringTable>())
+{
+}
+
+FS::FS(const std::shared_ptr<StringTable> & strings) :
+    strings(strings),
+    pool(std::make_shared<NodePool>()),
+    root(strings->intern("<root>"), strings->intern("")),
+    threads(1),
+    lazy(false),
+    zero_copy(false),
+    packed_lists(false),
+    compact(false),
+    deferring(NULL)
 {
 }
 
 FS::~FS()
 {
+	// Before pools of the files are freed
+	root.deleteChildren();
 }
 
 bool FS::read(const std::string & path)
+{
+	std::vector<std::string> files;
+	if (!listPath(path, files))
+		return false;
+	
+	paths.push_back(path);
+	
+	std::vector<size_t> ids;
+	for (auto & file : files)
+	{
+		ids.push_back(sources.size());
+		sources.push_back(Source(file));
+	}
+	
+	return readSources(ids);
+}
+
+bool FS::readBuffer(const char * data, size_t size, const std::string & name)
+{
+	currentPath = name;
+	
+	IFileIterator it(data, size);
+	return readParts(it, pool, nullptr);
+}
+
+bool FS::readString(const std::string & str, const std::string & name)
+{
+	return readBuffer(str.data(), str.size(), name);
+}
+
+bool FS::refresh()
+{
+	std::vector<std::string> files;
+	for (auto & path : paths)
+	{
+		if (is_directory(path))
+			listDirectory(path, files);
+		else if (is_regular_file(path))
+			files.push_back(path);
+	}
+	
+	// Match files with ones read before, in the same order if a file was read many times.
+	std::multimap<std::string, size_t> old;
+	for (size_t i = 0; i < sources.size(); i++)
+		old.insert(std::make_pair(sources[i].path, i));
+	
+	std::vector<Source> current;
+	std::vector<size_t> renumber(sources.size(), 0);  // Old index -> new index + 1, 0 if nodes of the file must be removed
+	std::vector<size_t> changed;
+	
+	for (auto & file : files)
+	{
+		auto it = old.lower_bound(file);
+		if (it != old.end() && it->first == file)
+		{
+			size_t i = it->second;
+			old.erase(it);
+			
+			if (isUnchanged(sources[i]))
+			{
+				current.push_back(sources[i]);
+				renumber[i] = current.size();
+				continue;
+			}
+		}
+		
+		changed.push_back(current.size());
+		current.push_back(Source(file));
+	}
+	
+	if (changed.empty() && current.size() == sources.size())
+		return true;
+	
+	// Nodes are ranked by their file, and nodes not read from files by the file before them.
+	// Both old and new nodes are in order of their ranks, and nodes read from files go first.
+	std::unordered_set<const Node *> removed;
+	std::unordered_map<const Node *, size_t> untracked;
+	size_t last = 0;
+	
+	for (auto & child : root.getIndex())
+	{
+		if (child->source)
+		{
+			child->source = renumber[child->source - 1];
+			if (!child->source)
+			{
+				removed.insert(child);
+				continue;
+			}
+			last = child->source;
+		}
+		else
+			untracked[child] = last;
+	}
+	
+	// Old sources keep memory of the removed nodes until they are disposed
+	std::vector<Source> previous;
+	previous.swap(sources);
+	sources = current;
+	
+	// Changed files are read into their own tree, which is then merged into root
+	FS fresh(strings);
+	fresh.threads = threads;
+	fresh.lazy = lazy;
+	fresh.zero_copy = zero_copy;
+	fresh.packed_lists = packed_lists;
+	
+	std::vector<size_t> ids;
+	for (auto & id : changed)
+	{
+		ids.push_back(fresh.sources.size());
+		fresh.sources.push_back(sources[id]);
+	}
+	
+	bool result = fresh.readSources(ids);
+	if (!result)
+	{
+		currentPath = fresh.currentPath;
+		errorMsg = fresh.errorMsg;
+	}
+	
+	for (size_t i = 0; i < changed.size(); i++)
+		sources[changed[i]] = fresh.sources[i];
+	for (auto & child : fresh.root.getIndex())
+		child->source = changed[child->source - 1] + 1;
+	pool->adopt(fresh.pool);
+	
+	root.spliceChildren(fresh.root, [&removed](const Node * node)
+	{
+		return removed.count(node) > 0;
+	},
+	[&untracked](const Node * a, const Node * b)
+	{
+		size_t rank_a = a->source ? a->source : untracked.find(a)->second;
+		size_t rank_b = b->source ? b->source : untracked.find(b)->second;
+		return rank_a < rank_b || (rank_a == rank_b && a->source && !b->source);
+	});
+	
+	return result;
+}
+
+bool FS::writeBack()
+{
+	// Top-level nodes of each file, and files which must be written
+	std::vector<std::vector<Node *>> nodes(sources.size());
+	std::vector<bool> changed(sources.size(), false);
+	for (auto & child : root.getIndex())
+	{
+		if (!child->source)
+			continue;
+		
+		nodes[child->source - 1].push_back(child);
+		if (child->changed)
+			changed[child->source - 1] = true;
+	}
+	
+	bool result = true;
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		if (!changed[i] && nodes[i].size() == sources[i].nodes)
+			continue;
+		
+		if (!sources[i].complete)
+		{
+			currentPath = sources[i].path;
+			setError("it wasn't read completely, so it can't be written back");
+			result = false;
+			continue;
+		}
+		
+		if (!writeSource(sources[i], nodes[i]))
+			result = false;
+	}
+	
+	return result;
+}
+
+bool FS::parse(const std::string & path, Handler & handler)
+{
+	std::vector<std::string> files;
+	if (!listPath(path, files))
+		return false;
+	
+	for (auto & file : files)
+		if (!readFile(file, handler))
+			return false;
+	
+	return true;
+}
+
+bool FS::parseBuffer(const char * data, size_t size, Handler & handler, const std::string & name)
+{
+	currentPath = name;
+	
+	IFileIterator it(data, size);
+	return readBlock(it, handler);
+}
+
+bool FS::listPath(const std::string & path, std::vector<std::string> & files)
 {
 	currentPath = path;
 	
@@ -30,14 +268,41 @@ bool FS::read(const std::string & path)
 	}
 	
 	if (is_directory(path))
-		return readDirectory(path);
+		listDirectory(path, files);
 	else if (is_regular_file(path))
-		return readFile(path);
+		files.push_back(path);
 	else
 	{
 		setError("it isn't directory nor regular file");
 		return false;
 	}
+	
+	return true;
+}
+
+void FS::setThreads(unsigned count)
+{
+	threads = count;
+}
+
+void FS::setLazy(bool lazy)
+{
+	this->lazy = lazy;
+}
+
+void FS::setZeroCopy(bool zero_copy)
+{
+	this->zero_copy = zero_copy;
+}
+
+void FS::setPackedLists(bool packed)
+{
+	packed_lists = packed;
+}
+
+void FS::setCompact(bool compact)
+{
+	this->compact = compact;
 }
 
 const std::string & FS::getError() const
@@ -49,16 +314,121 @@ bool FS::write(const std::string & path)
 {
 	currentPath = path;
 	
-	std::ofstream file(path.c_str());
-	if (!file.is_open())
+	FILE * file = fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		setError("can't open");
+		return false;
+	}
+	
+	TextWriter writer(file);
+	writer.setCompact(compact);
+	bool result = writer.write(root.getIndex());
+	
+	if (fclose(file) != 0 || !result)
+	{
+		setError("can't write");
+		return false;
+	}
+	
+	return true;
+}
+
+bool FS::write(std::ostream & stream)
+{
+	currentPath = "<stream>";
+	
+	TextWriter writer(stream);
+	writer.setCompact(compact);
+	if (!writer.write(root.getIndex()))
+	{
+		setError("can't write");
+		return false;
+	}
+	
+	return true;
+}
+
+void FS::writeString(std::string & str) const
+{
+	TextWriter writer(str);
+	writer.setCompact(compact);
+	writer.write(root.getIndex());
+}
+
+bool FS::writeBinary(const std::string & path)
+{
+	currentPath = path;
+	
+	FILE * file = fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		setError("can't open");
+		return false;
+	}
+	
+	BinaryWriter writer(file);
+	bool result = writer.write(root);
+	
+	if (fclose(file) != 0 || !result)
+	{
+		setError("can't write");
+		return false;
+	}
+	
+	return true;
+}
+
+bool FS::writeImage(const std::string & path)
+{
+	currentPath = path;
+	
+	TreeArrays arrays;
+	try {
+		arrays.build(root);
+	}
+	catch (const std::length_error & e)
+	{
+		setError(e.what());
+		return false;
+	}
+	
+	FILE * file = fopen(path.c_str(), "wb");
+	if (!file)
 	{
 		setError("can't open");
 		return false;
 	}
 	
-	writeRoot(file);
+	bool result = arrays.write(file);
+	
+	if (fclose(file) != 0 || !result)
+	{
+		setError("can't write");
+		return false;
+	}
+	
+	return true;
+}
+
+bool FS::readBinary(const std::string & path)
+{
+	currentPath = path;
 	
-	file.close();
+	try {
+		MappedFile file(path);
+		BinaryReader reader(file.data(), file.size(), *pool, *strings);
+		if (!reader.read(root))
+		{
+			setError("corrupted binary file");
+			return false;
+		}
+	}
+	catch (const std::runtime_error & e)
+	{
+		setError(e.what());
+		return false;
+	}
 	
 	return true;
 }
@@ -73,7 +443,300 @@ const Node & FS::getRoot() const
 	return root;
 }
 
-bool FS::readDirectory(const std::string & path)
+bool FS::readSources(const std::vector<size_t> & ids)
+{
+	if (getThreadCount() == 1 || ids.size() < 2)
+	{
+		for (auto & id : ids)
+			if (!readSource(id))
+				return false;
+		
+		return true;
+	}
+	
+	// Each file is read into its own FS. Files after the first failed one are not needed, like in sequential reading.
+	std::vector<std::unique_ptr<FS>> parts(ids.size());
+	std::atomic<size_t> failed(ids.size());
+	
+	parallelFor(ids.size(), getThreadCount(), [&](size_t i)
+	{
+		if (i > failed)
+			return;
+		
+		parts[i].reset(new FS(strings));
+		parts[i]->lazy = lazy;
+		parts[i]->zero_copy = zero_copy;
+		parts[i]->packed_lists = packed_lists;
+		parts[i]->sources.push_back(sources[ids[i]]);
+		if (!parts[i]->readSource(0))
+			lowerTo(failed, i);
+	});
+	
+	for (size_t i = 0; i < ids.size() && i <= failed; i++)
+	{
+		sources[ids[i]] = parts[i]->sources[0];
+		
+		size_t first = root.size();
+		root.takeChildren(parts[i]->root);
+		pool->adopt(parts[i]->pool);
+		markSource(first, ids[i]);
+	}
+	
+	if (failed < ids.size())
+	{
+		currentPath = sources[ids[failed]].path;
+		errorMsg = parts[failed]->getError();
+		return false;
+	}
+	
+	return true;
+}
+
+bool FS::readSource(size_t id)
+{
+	Source & source = sources[id];
+	currentPath = source.path;
+	
+	// Taken before reading, so that later modification can't be missed. It can have the same
+	// time though, so isUnchanged() compares contents of files modified shortly before this.
+	boost::system::error_code error;
+	source.time = last_write_time(source.path, error);
+	source.checked = std::time(NULL);
+	source.size = file_size(source.path, error);
+	source.complete = false;
+	
+	size_t first = root.size();
+	bool result;
+	
+	try {
+		IFileIterator it(source.path);
+		source.hash = hashContents(it.getCurrent(), it.getEnd() - it.getCurrent());
+		
+		if (zero_copy)
+			source.file = it.getFile();
+		
+		// Nodes of each file have their own pool, so that its memory is freed when they are read again
+		source.pool = std::make_shared<NodePool>();
+		result = readParts(it, source.pool, lazy ? std::make_shared<LazySource>(source.path, it, source.pool, strings, zero_copy, packed_lists) : nullptr);
+	}
+	catch (const std::runtime_error & e)
+	{
+		setError(e.what());
+		result = false;
+	}
+	
+	markSource(first, id);
+	source.complete = result;
+	return result;
+}
+
+bool FS::readParts(IFileIterator & it, const std::shared_ptr<NodePool> & nodes, const std::shared_ptr<const LazySource> & source)
+{
+	unsigned count = getThreadCount();
+	size_t size = it.getEnd() - it.getCurrent();
+	
+	std::vector<const char *> points;
+	if (count > 1 && size >= 2 * min_part_size)
+		points = findSplitPoints(it.getCurrent(), it.getEnd(), std::max(min_part_size, size / (4 * count)));
+	
+	if (points.empty())
+	{
+		TreeBuilder builder(root, *nodes, *strings, source);
+		if (zero_copy)
+			builder.referTo(it.getCurrent(), it.getEnd());
+		if (packed_lists)
+			builder.packLists();
+		deferring = source ? &builder : NULL;
+		bool result = readBlock(it, builder);
+		deferring = NULL;
+		return result;
+	}
+	
+	points.insert(points.begin(), it.getCurrent());
+	points.push_back(it.getEnd());
+	
+	// Like in readSources(), parts after the first failed one are not needed.
+	size_t parts_count = points.size() - 1;
+	std::vector<std::unique_ptr<FS>> parts(parts_count);
+	std::atomic<size_t> failed(parts_count);
+	
+	parallelFor(parts_count, count, [&](size_t i)
+	{
+		if (i > failed)
+			return;
+		
+		parts[i].reset(new FS(strings));
+		parts[i]->currentPath = currentPath;
+		
+		IFileIterator part(it, points[i], points[i + 1]);
+		TreeBuilder builder(parts[i]->root, *parts[i]->pool, *strings, source);
+		if (zero_copy)
+			builder.referTo(it.getCurrent(), it.getEnd());
+		if (packed_lists)
+			builder.packLists();
+		parts[i]->deferring = source ? &builder : NULL;
+		if (!parts[i]->readBlock(part, builder))
+			lowerTo(failed, i);
+	});
+	
+	for (size_t i = 0; i < parts_count && i <= failed; i++)
+	{
+		root.takeChildren(parts[i]->root);
+		nodes->adopt(parts[i]->pool);
+	}
+	
+	it.setCurrent(it.getEnd());
+	
+	if (failed < parts_count)
+	{
+		errorMsg = parts[failed]->getError();
+		return false;
+	}
+	
+	return true;
+}
+
+void FS::expand(Node & node)
+{
+	std::unique_ptr<LazyBody> body(node.children->body);
+	node.children->body = NULL;
+	
+	// Incorrect contents are parsed only once, but they throw every time
+	if (!body->error.empty())
+	{
+		node.children->body = body.release();
+		throw std::runtime_error(node.children->body->error);
+	}
+	
+	FS fs(body->source->table);
+	fs.currentPath = body->source->path;
+	
+	// Nodes are created in the pool of the tree, other nodes can be parsed at the same time.
+	NodePool & pool = *body->source->pool;
+	auto lock = pool.lock();
+	
+	bool result;
+	{
+		IFileIterator it(body->source->whole, body->from, body->to);
+		TreeBuilder builder(node, pool, *body->source->table, body->source);
+		if (body->source->zero_copy)
+			builder.referTo(body->source->whole.getCurrent(), body->source->whole.getEnd());
+		if (body->source->packed_lists)
+			builder.packLists();
+		fs.deferring = &builder;
+		
+		result = (*it == '{') ? fs.readBlock(it, builder, '}') : fs.readList(it, builder);
+	}
+	
+	if (!result)
+	{
+		// Children parsed before the error are removed, and the node stays unparsed
+		Children & children = *node.children;
+		for (auto & child : children.block_index)
+			Node::dispose(child);
+		children.block_index.clear();
+		children.block.clear();
+		delete children.packed;
+		children.packed = NULL;
+		
+		body->error = fs.getError();
+		children.body = body.release();
+		throw std::runtime_error(children.body->error);
+	}
+}
+
+void FS::markSource(size_t first, size_t id)
+{
+	for (size_t i = first; i < root.getIndex().size(); i++)
+		root.getIndex()[i]->source = id + 1;
+	sources[id].nodes = root.getIndex().size() - first;
+}
+
+bool FS::writeSource(Source & source, const std::vector<Node *> & nodes)
+{
+	currentPath = source.path;
+	
+	std::string contents;
+	TextWriter writer(contents);
+	writer.setCompact(compact);
+	writer.write(nodes);
+	
+	// Written next to the file, so that renaming doesn't move it between file systems
+	boost::system::error_code error;
+	path temporary = unique_path(source.path + ".%%%%-%%%%.tmp", error);
+	FILE * file = error ? NULL : fopen(temporary.c_str(), "wb");
+	if (!file)
+	{
+		setError("can't open temporary file");
+		return false;
+	}
+	
+	bool written = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+	if (fclose(file) != 0 || !written)
+	{
+		remove(temporary, error);
+		setError("can't write");
+		return false;
+	}
+	
+	// The file keeps its permissions
+	boost::system::error_code ignored;
+	file_status old = status(source.path, ignored);
+	if (exists(old))
+		permissions(temporary, old.permissions(), ignored);
+	
+	rename(temporary, source.path, error);
+	if (error)
+	{
+		remove(temporary, error);
+		setError("can't replace");
+		return false;
+	}
+	
+	source.time = last_write_time(source.path, error);
+	source.size = contents.size();
+	source.hash = hashContents(contents.data(), contents.size());
+	source.nodes = nodes.size();
+	for (auto & node : nodes)
+		node->changed = false;
+	
+	return true;
+}
+
+bool FS::isUnchanged(Source & source)
+{
+	if (!source.complete)
+		return false;
+	
+	boost::system::error_code error;
+	std::time_t now = std::time(NULL);
+	std::time_t time = last_write_time(source.path, error);
+	uintmax_t size = file_size(source.path, error);
+	if (error || size != source.size)
+		return false;
+	
+	// Times have a resolution of seconds (two on some file systems), so a file modified in the same
+	// second as it was checked has the same time afterwards.
+	if (time == source.time && time + modification_margin < source.checked)
+		return true;
+	
+	// Touched, or modified too recently to tell, but maybe not modified
+	try {
+		MappedFile file(source.path);
+		if (hashContents(file.data(), file.size()) != source.hash)
+			return false;
+	}
+	catch (const std::runtime_error &)
+	{
+		return false;
+	}
+	
+	source.time = time;
+	source.checked = now;
+	return true;
+}
+
+void FS::listDirectory(const std::string & path, std::vector<std::string> & files)
 {
 	std::vector<boost::filesystem::path> vec;
 	std::copy(directory_iterator(path), directory_iterator(), back_inserter(vec));
@@ -82,27 +745,38 @@ bool FS::readDirectory(const std::string & path)
 	for (auto & p : vec)
 	{
 		if (is_regular_file(p))
-		{
-			if (!readFile(p.string()))
-				return false;
-		}
+			files.push_back(p.string());
 		else if (is_directory(p))
-		{
-			if (!readDirectory(p.string()))
-				return false;
-		}
+			listDirectory(p.string(), files);
 	}
+}
+
+bool FS::readChunk(IFileIterator & it, Handler * handler)
+{
+	if (handler)
+		return readBlock(it, *handler);
 	
-	return true;
+	// Chunks are gone after parsing, so scalars are always copied
+	TreeBuilder builder(root, *pool, *strings, nullptr);
+	if (packed_lists)
+		builder.packLists();
+	return readBlock(it, builder);
 }
 
-bool FS::readFile(const std::string & path)
+unsigned FS::getThreadCount() const
+{
+	if (threads == 0)
+		return std::max(1u, std::thread::hardware_concurrency());
+	return threads;
+}
+
+bool FS::readFile(const std::string & path, Handler & handler)
 {
 	currentPath = path;
 	
 	try {
 		IFileIterator it(path);
-		return readBlock(it, root);
+		return readBlock(it, handler);
 	}
 	catch (const std::runtime_error & e)
 	{
@@ -113,35 +787,50 @@ bool FS::readFile(const std::string & path)
 
 void FS::skipWhitespace(IFileIterator & i)
 {
-	while (i.isValid() && isspace(*i))
-		++i;
+	i.setCurrent(detail::findNotSpace(i.getCurrent(), i.getEnd()));
 	while (*i == '#')
 	{
 		skipComment(i);
-		while (i.isValid() && isspace(*i))
-			++i;
+		i.setCurrent(detail::findNotSpace(i.getCurrent(), i.getEnd()));
 	}
 }
 
 void FS::skipComment(IFileIterator & i)
 {
-	while (i.isValid() && *i != '\n')
-		++i;
+	i.setCurrent(detail::findNewline(i.getCurrent(), i.getEnd()));
 	if (i.isValid())
 		++i;
 }
 
-bool FS::readValue(IFileIterator & iterator, Node & output)
+bool FS::readValue(IFileIterator & iterator, Handler & handler)
 {
+	if (deferring && (*iterator == '{' || *iterator == '['))
+	{
+		// Only non-empty brackets closed by the matching bracket are deferred, errors in others are found now.
+		const char * from = iterator.getCurrent();
+		const char * to = skipBrackets(from, iterator.getEnd());
+		
+		if (to && to[-1] == (*from == '{' ? '}' : ']') && skipSpacesAndComments(from + 1, to - 1) != to - 1)
+		{
+			deferring->defer(from, to);
+			iterator.setCurrent(to);
+			return true;
+		}
+	}
+	
 	if (*iterator == '{')
 	{
-		if (!readBlock(iterator, output, '}'))
+		handler.beginGroup();
+		if (!readBlock(iterator, handler, '}'))
 			return false;
+		handler.endGroup();
 	}
 	else if (*iterator == '[')
 	{
-		if (!readList(iterator, output))
+		handler.beginList();
+		if (!readList(iterator, handler))
 			return false;
+		handler.endList();
 	}
 	else if (*iterator == ';')
 	{
@@ -150,16 +839,17 @@ bool FS::readValue(IFileIterator & iterator, Node & output)
 	}
 	else
 	{
-		std::string str;
-		if (!readScalar(iterator, str))
+		StringRef str;
+		std::string buffer;
+		if (!readScalar(iterator, str, buffer))
 			return false;
-		output.setScalar(str);
+		handler.scalar(str);
 	}
 	
 	return true;
 }
 
-bool FS::readList(IFileIterator & iterator, Node & owner)
+bool FS::readList(IFileIterator & iterator, Handler & handler)
 {
 	iterator++;
 	
@@ -167,12 +857,13 @@ bool FS::readList(IFileIterator & iterator, Node & owner)
 	
 	while (iterator.isValid() && *iterator != ']')
 	{
-		Node * node = new Node;
-		owner.insert(node);
+		handler.beginNode("", "");
 		
-		if (!readValue(iterator, *node))
+		if (!readValue(iterator, handler))
 			return false;
 		
+		handler.endNode();
+		
 		skipWhitespace(iterator);
 		
 		if (iterator.isValid() && *iterator != ']' && *iterator != ',')
@@ -198,27 +889,29 @@ bool FS::readList(IFileIterator & iterator, Node & owner)
 }
 
 bool FS::readScalar(IFileIterator & iterator, std::string & output)
+{
+	StringRef str;
+	if (!readScalar(iterator, str, output))
+		return false;
+	
+	if (str.data() != output.data())
+		output.assign(str.data(), str.size());
+	return true;
+}
+
+bool FS::readScalar(IFileIterator & iterator, StringRef & output, std::string & buffer)
 {
 	if (*iterator == '"' || *iterator == '\'')
-		return readQuotedScalar(iterator, output);
+		return readQuotedScalar(iterator, output, buffer);
 	else
 		return readNotQuotedScalar(iterator, output);
 }
 
-bool FS::readNotQuotedScalar(IFileIterator & iterator, std::string & output)
+bool FS::readNotQuotedScalar(IFileIterator & iterator, StringRef & output)
 {
-	output.clear();
-	
-	while (iterator.isValid() && isgraph(*iterator)
-	       && *iterator != '=' && *iterator != ';'
-	       && *iterator != '{' && *iterator != '}'
-	       && *iterator != '[' && *iterator != ']'
-	       && *iterator != ','
-	       && *iterator != '#')
-	{
-		output += *iterator;
-		iterator++;
-	}
+	const char * end = detail::findScalarEnd(iterator.getCurrent(), iterator.getEnd());
+	output = StringRef(iterator.getCurrent(), end - iterator.getCurrent());
+	iterator.setCurrent(end);
 	
 	if (output.empty())
 	{
@@ -229,48 +922,58 @@ bool FS::readNotQuotedScalar(IFileIterator & iterator, std::string & output)
 	return true;
 }
 
-bool FS::readQuotedScalar(IFileIterator & iterator, std::string & output)
+bool FS::readQuotedScalar(IFileIterator & iterator, StringRef & output, std::string & buffer)
 {
 	char quote = *iterator;
 	iterator++;
 	
-	output.clear();
+	// Without escape sequences the string is just the data between quotes
+	const char * first = detail::findQuoteOrEscape(iterator.getCurrent(), iterator.getEnd(), quote);
+	if (first != iterator.getEnd() && *first == quote)
+	{
+		output = StringRef(iterator.getCurrent(), first - iterator.getCurrent());
+		iterator.setCurrent(first + 1);
+		return true;
+	}
+	
+	buffer.assign(iterator.getCurrent(), first);
+	iterator.setCurrent(first);
 	
-	while (iterator.isValid() && *iterator != quote)
+	while (iterator.isValid())
 	{
-		if (*iterator == '\\')
+		// Characters up to the next quote or escape sequence are copied at once
+		const char * end = detail::findQuoteOrEscape(iterator.getCurrent(), iterator.getEnd(), quote);
+		buffer.append(iterator.getCurrent(), end);
+		iterator.setCurrent(end);
+		
+		if (!iterator.isValid() || *iterator == quote)
+			break;
+		
+		iterator++;
+		if (!iterator.isValid())
 		{
-			iterator++;
-			if (!iterator.isValid())
-			{
-				setParsingError("incomplete escape sequence", iterator);
-				return false;
-			}
-			
-			switch (*iterator)
-			{
-			case 'b':
-				output += '\b';
-				break;
-			case 'n':
-				output += '\n';
-				break;
-			case 'r':
-				output += '\r';
-				break;
-			case 't':
-				output += '\t';
-				break;
-			default:
-				output += *iterator;
-			}
-			iterator++;
+			setParsingError("incomplete escape sequence", iterator);
+			return false;
 		}
-		else
+		
+		switch (*iterator)
 		{
-			output += *iterator;
-			iterator++;
+		case 'b':
+			buffer += '\b';
+			break;
+		case 'n':
+			buffer += '\n';
+			break;
+		case 'r':
+			buffer += '\r';
+			break;
+		case 't':
+			buffer += '\t';
+			break;
+		default:
+			buffer += *iterator;
 		}
+		iterator++;
 	}
 	
 	if (*iterator != quote)
@@ -280,10 +983,11 @@ bool FS::readQuotedScalar(IFileIterator & iterator, std::string & output)
 	}
 	
 	iterator++;
+	output = StringRef(buffer);
 	return true;
 }
 
-bool FS::readNode(IFileIterator & it, Node & parent)
+bool FS::readNode(IFileIterator & it, Handler & handler)
 {
 	std::string name;
 	if (!readScalar(it, name))
@@ -309,8 +1013,7 @@ bool FS::readNode(IFileIterator & it, Node & parent)
 			return false;
 	}
 	
-	Node * node = new Node(name, identifier);
-	parent.insert(node);
+	handler.beginNode(name, identifier);
 	
 	skipWhitespace(it);
 	if (!it.isValid())
@@ -336,14 +1039,14 @@ bool FS::readNode(IFileIterator & it, Node & parent)
 		}
 	}
 	
-	if (!readValue(it, *node))
+	if (!readValue(it, handler))
 		return false;
 	
 	
 	skipWhitespace(it);
 	if (it.isValid() && *it == ',')
 	{
-		node->shake();
+		handler.continueAsList();
 		
 		while (it.isValid() && *it == ',')
 		{
@@ -355,20 +1058,24 @@ bool FS::readNode(IFileIterator & it, Node & parent)
 				return false;
 			}
 			
-			Node * subnode = new Node;
-			node->insert(subnode);
+			handler.beginNode("", "");
 			
-			if (!readValue(it, *subnode))
+			if (!readValue(it, handler))
 				return false;
 			
+			handler.endNode();
+			
 			skipWhitespace(it);
 		}
+		
+		handler.endList();
 	}
 	
+	handler.endNode();
 	return true;
 }
 
-bool FS::readBlock(IFileIterator & it, Node & owner, char end)
+bool FS::readBlock(IFileIterator & it, Handler & handler, char end)
 {
 	if (end)
 		it++;
@@ -376,7 +1083,7 @@ bool FS::readBlock(IFileIterator & it, Node & owner, char end)
 	
 	while (it.isValid() && (end ? *it != end : true))
 	{
-		if (!readNode(it, owner))
+		if (!readNode(it, handler))
 			return false;
 		
 		skipWhitespace(it);
@@ -393,132 +1100,6 @@ bool FS::readBlock(IFileIterator & it, Node & owner, char end)
 	return true;
 }
 
-void FS::writeRoot(std::ofstream & file) const
-{
-	for (unsigned i = 0; i < getRoot().size(); i++)
-	{
-		file << "\n\n";
-		writeNode(file, getRoot()[i]);
-	}
-}
-
-void FS::writeNode(std::ofstream & file, const Node & node, int d) const
-{
-	for (int i = 0; i < d; i++)
-		file << '\t';
-	
-	if (node.hasName())
-	{
-		file << node.getName() << ' ';
-		
-		if (node.hasIdentifier())
-			file << node.getIdentifier() << ' ';
-	
-		file << "= ";
-	}
-	
-	if (node.getType() == Node::Type::Null)
-	{
-		file << "{}";
-	}
-	
-	if (node.getType() == Node::Type::Scalar)
-	{
-		file << escapeScalar(node.getScalar());
-	}
-	
-	if (node.getType() == Node::Type::List)
-	{
-		file << "[\n";
-		if (node.size() > 0)
-			writeNode(file, node[0], d+1);
-		
-		for (unsigned i = 1; i < node.size(); i++)
-		{
-			file << ",\n";
-			writeNode(file, node[i], d+1);
-		}
-		
-		file << '\n';
-		for (int i = 0; i < d; i++)
-			file << '\t';
-		file << ']';
-	}
-	
-	if (node.getType() == Node::Type::Group)
-	{
-		file << "{";
-		
-		for (unsigned i = 0; i < node.size(); i++)
-		{
-			file << "\n";
-			writeNode(file, node[i], d+1);
-		}
-		
-		file << "\n\n";
-		for (int i = 0; i < d; i++)
-			file << '\t';
-		file << '}';
-	}
-}
-
-std::string FS::escapeScalar(const std::string & str) const
-{
-	std::string r;
-	bool must_be_quoted = false;
-	
-	for (auto & i : str)
-	{
-		if (!(isgraph(i)  && i != '=' && i != '{' && i != '}'
-		       && i != '[' && i != ']' && i != ',' && i != '#'))
-			must_be_quoted = true;
-		
-		if (i == '\\')
-		{
-			must_be_quoted = true;
-			r += "\\\\";
-		}
-		else if (i == '\b')
-		{
-			must_be_quoted = true;
-			r += "\\b";
-		}
-		else if (i == '\n')
-		{
-			must_be_quoted = true;
-			r += "\\n";
-		}
-		else if (i == '\r')
-		{
-			must_be_quoted = true;
-			r += "\\r";
-		}
-		else if (i == '\t')
-		{
-			must_be_quoted = true;
-			r += "\\t";
-		}
-		else if (i == '\"')
-		{
-			must_be_quoted = true;
-			r += "\\\"";
-		}
-		else if (i == '\'')
-		{
-			must_be_quoted = true;
-			r += "\\\'";
-		}
-		else
-			r += i;
-		
-	}
-	
-	if (must_be_quoted)
-		return "\"" + r + "\"";
-	else
-		return r;
-}
-
 void FS::print() const
 {
 	root.print();
@@ -537,11 +1118,11 @@ void FS::setParsingError(const std::string & string, const IFileIterator & itera
 	errorMsg = "Error in \"";
 	errorMsg += currentPath;
 	errorMsg += "\" at line ";
-	errorMsg += to_string<int>(iterator.getLine());
+	errorMsg += to_string(iterator.getLine());
 	errorMsg += ", char ";
-	errorMsg += to_string<int>(iterator.getChar());
+	errorMsg += to_string(iterator.getChar());
 	errorMsg += " (";
-	errorMsg += to_string<int>(iterator.getIndex());
+	errorMsg += to_string(iterator.getIndex());
 	errorMsg += "): ";
 	errorMsg += string;
 }
@@ -1,13 +1,24 @@
 #ifndef _PPK_FS_HPP
 #define _PPK_FS_HPP
 
+#include <cstdint>
+#include <ctime>
+#include <iosfwd>
+#include <memory>
+
 #include "Node.hpp"
+#include "Handler.hpp"
 
 namespace ppk
 {
 
 namespace detail {
 class IFileIterator;
+class TreeBuilder;
+class NodePool;
+class MappedFile;
+class StringTable;
+struct LazySource;
 }
 
 /**
@@ -15,6 +26,9 @@ class IFileIterator;
  */
 class FS
 {
+	friend class Node;
+	friend class FeedParser;
+	
 public:
 	/// Standard constructor.
 	FS();
@@ -46,6 +60,145 @@ public:
 	 */
 	bool read(const std::string & path);
 	
+	/**
+	 * @brief Reads data from memory.
+	 * 
+	 * The buffer is parsed in place: it is not copied and it isn't needed after
+	 * the call returns. Like read(), it adds new data to the end.
+	 * 
+	 * @param data -- beginning of the buffer
+	 * @param size -- its length in bytes
+	 * @param name -- name of the data used in error messages
+	 * @return true if no errors happened @see getError()
+	 */
+	bool readBuffer(const char * data, size_t size, const std::string & name = "<buffer>");
+	
+	/**
+	 * @brief Reads data from a string.
+	 * @see readBuffer()
+	 */
+	bool readString(const std::string & str, const std::string & name = "<string>");
+	
+	/**
+	 * @brief Reads again files that changed since they were read.
+	 * 
+	 * Checks all paths given to read(). Top-level nodes of modified files are removed
+	 * and read again, nodes of deleted files are removed and new files are read.
+	 * Nodes of unchanged files are left untouched, so references to them stay valid.
+	 * A file is modified if its size, or both modification time and contents differ. Contents
+	 * are compared also if the file was modified within two seconds before it was read,
+	 * as a later modification in the same second doesn't change the time.
+	 * 
+	 * Afterwards the root has children in the same order as if everything was read again.
+	 * Nodes that were not read from files (e.g. added by hand or by readBuffer()) stay
+	 * after the node which preceded them.
+	 * 
+	 * @return true if no errors happened @see getError()
+	 */
+	bool refresh();
+	
+	/**
+	 * @brief Writes again files whose nodes were modified since they were read or written.
+	 * 
+	 * A file is rewritten if any node read from it was changed by operator=, setScalar(),
+	 * setIdentifier(), emplace(), insert(), clear() or any remove method, or if any of its
+	 * top-level nodes was removed. Other files are not touched. Each file is replaced at once,
+	 * by renaming a temporary file written next to it, so it is never left half written.
+	 * 
+	 * Nodes that were not read from files (e.g. added to the root by hand) are not written.
+	 * Files that couldn't be read completely are not written either, as that would lose the rest.
+	 * Written files count as unchanged for refresh().
+	 * 
+	 * @return true if no errors happened @see getError()
+	 */
+	bool writeBack();
+	
+	
+	/**
+	 * @brief Parses data from given path without building a tree.
+	 * 
+	 * Works like read(), but instead of adding nodes to the root it reports
+	 * them to the handler as they are read, so memory use doesn't depend on size of data.
+	 * 
+	 * @param path
+	 * @param handler -- receiver of the events
+	 * @return true if no errors happened @see getError()
+	 */
+	bool parse(const std::string & path, Handler & handler);
+	
+	/**
+	 * @brief Parses data from memory without building a tree.
+	 * @see parse(), readBuffer()
+	 */
+	bool parseBuffer(const char * data, size_t size, Handler & handler, const std::string & name = "<buffer>");
+	
+	/**
+	 * @brief Sets number of threads used by read() and readBuffer().
+	 * 
+	 * Files in a directory are then parsed concurrently, and large files or buffers are split
+	 * between top-level nodes into parts parsed concurrently. Nodes are added in the same
+	 * order as when reading with one thread, and errors are reported at the same positions.
+	 * 
+	 * @param count -- number of threads, 0 means one per processor core. The default is 1.
+	 */
+	void setThreads(unsigned count);
+	
+	/**
+	 * @brief Sets if read() parses contents of groups and lists only when they are needed.
+	 * 
+	 * Reading then only skips brackets. Their contents are parsed the first time
+	 * children of the node are used, e.g. by Node::size(), Node::operator[]() or Node::all().
+	 * It is much faster and uses less memory if only a small part of data is used.
+	 * 
+	 * Contents of files are kept in memory (mapped if possible) until all their nodes
+	 * are parsed or removed, and the files shouldn't be modified in place meanwhile.
+	 * Errors inside brackets are not found by read(). Instead, using such node throws
+	 * std::runtime_error with the error message. Nodes which are not parsed yet can't be
+	 * used from many threads at once. Buffers given to readBuffer() are always parsed at once.
+	 * 
+	 * @param lazy -- the default is false
+	 */
+	void setLazy(bool lazy);
+	
+	/**
+	 * @brief Sets if scalars read by read() and readBuffer() refer to the data instead of being copied.
+	 * 
+	 * Only scalars with escape sequences are copied then, so reading allocates much less memory.
+	 * Contents of files are kept in memory (mapped if possible) as long as their nodes, and the files
+	 * shouldn't be modified in place meanwhile. Buffers given to readBuffer() and readString() must
+	 * outlive nodes read from them. Scalars set later, e.g. by Node::setScalar(), are always copied.
+	 * 
+	 * @param zero_copy -- the default is false
+	 */
+	void setZeroCopy(bool zero_copy);
+	
+	/**
+	 * @brief Sets if read() and readBuffer() keep lists of numbers in packed arrays instead of nodes.
+	 * 
+	 * Each number then takes 8 or 9 bytes instead of a whole Node. Nodes of the numbers are made
+	 * the first time they are used, e.g. by Node::operator[]() or Node::all(), while Node::size()
+	 * and Node::extract() don't need them. Lists of such nodes can't be used from many threads
+	 * at once, until their nodes are made.
+	 * 
+	 * Only numbers which are written so that the same text can be made of their values are packed:
+	 * decimal integers, and reals without exponents with at most 15 significant digits.
+	 * So scalars of the nodes are the same as they would be otherwise.
+	 * 
+	 * @param packed -- the default is false
+	 */
+	void setPackedLists(bool packed);
+	
+	/**
+	 * @brief Sets if write(), writeString() and writeBack() write compact text.
+	 * 
+	 * Compact text is the smallest one the parser reads into the same tree: without indentation,
+	 * with whitespaces only where they separate scalars, and with groups and lists inline,
+	 * like `a=1 b{c=2}l=[1,2]n;`. It is meant to be read by programs rather than people.
+	 * 
+	 * @param compact -- the default is false
+	 */
+	void setCompact(bool compact);
+	
 	/// Returns the last error message.
 	const std::string & getError() const;
 	
@@ -53,6 +206,36 @@ public:
 	/// Writes data to given file.
 	bool write(const std::string & path);
 	
+	/// Writes data to given stream, in the same format.
+	bool write(std::ostream & stream);
+	
+	/// Writes data to the end of given string, in the same format.
+	void writeString(std::string & str) const;
+	
+	
+	/**
+	 * @brief Writes data to given file as an image, which can be used by MappedTree.
+	 * 
+	 * It is a read-only copy of the tree, that is mapped into memory instead of being read.
+	 */
+	bool writeImage(const std::string & path);
+	
+	/**
+	 * @brief Writes data to given file in binary format.
+	 * 
+	 * It can't be edited by hand, but it is smaller and much faster to read than text.
+	 * @see readBinary()
+	 */
+	bool writeBinary(const std::string & path);
+	
+	/**
+	 * @brief Reads file written by writeBinary().
+	 * 
+	 * Like read(), it adds new data to the end.
+	 * @return true if no errors happened @see getError()
+	 */
+	bool readBinary(const std::string & path);
+	
 	
 	/// Returns the root node. (It always exists, even if nothing was read).
 	Node & getRoot();
@@ -65,10 +248,64 @@ public:
 	void print() const;
 	
 private:
+	std::shared_ptr<detail::StringTable> strings;  // Names and identifiers of nodes of the tree
+	std::shared_ptr<detail::NodePool> pool;  // Memory of nodes not read from files, e.g. by readBuffer()
 	Node root;
-	
-	bool readDirectory(const std::string & path);
-	bool readFile(const std::string & path);
+	unsigned threads;
+	bool lazy;
+	bool zero_copy;
+	bool packed_lists;
+	bool compact;
+	detail::TreeBuilder * deferring;  // Builder of the tree being read if contents of brackets are deferred, NULL otherwise
+	
+	// File read into the tree. Top-level nodes remember index of their file plus one.
+	struct Source
+	{
+		explicit Source(const std::string & path) : path(path), time(0), checked(0), size(0), hash(0), complete(false), nodes(0) {}
+		
+		std::string path;
+		std::time_t time;
+		std::time_t checked;  // When its contents were last known to have the hash
+		uintmax_t size;
+		uint64_t hash;
+		bool complete;  // false if reading failed
+		size_t nodes;  // Number of top-level nodes read from it
+		std::shared_ptr<detail::NodePool> pool;  // Memory of its nodes, NULL if it wasn't read
+		std::shared_ptr<const detail::MappedFile> file;  // Contents which scalars refer to, NULL if they are copied
+	};
+	
+	std::vector<std::string> paths;  // Given to read()
+	std::vector<Source> sources;
+	
+	explicit FS(const std::shared_ptr<detail::StringTable> & strings);  // Tree using given strings, used for parts read in other threads
+	
+	bool readFile(const std::string & path, Handler & handler);
+	
+	// Reads given sources into root. If there are many threads, each file is read into its own FS and then moved to root.
+	bool readSources(const std::vector<size_t> & ids);
+	bool readSource(size_t id);
+	void markSource(size_t first, size_t id);  // Sets source of root children starting from first
+	bool writeSource(Source & source, const std::vector<Node *> & nodes);  // Replaces the file with the nodes
+	
+	// Reads data into root. Large data is split between top-level nodes and the parts are read in many threads.
+	// Nodes are created in given pool. If there is a source, contents of brackets are deferred.
+	bool readParts(detail::IFileIterator & iterator, const std::shared_ptr<detail::NodePool> & nodes,
+	               const std::shared_ptr<const detail::LazySource> & source);
+	
+	// Reads a chunk of data given to FeedParser into root, or reports it to the handler if it isn't NULL
+	bool readChunk(detail::IFileIterator & iterator, Handler * handler);
+	
+	// Parses deferred children of the node. @throws std::runtime_error if they are incorrect
+	static void expand(Node & node);
+	bool isUnchanged(Source & source);
+	
+	// Appends path if it is a file or all files in it if it is a directory. Sets error if it is neither.
+	bool listPath(const std::string & path, std::vector<std::string> & files);
+	
+	// Appends paths of all files in directory, in depth-first alphabetical order
+	void listDirectory(const std::string & path, std::vector<std::string> & files);
+	
+	unsigned getThreadCount() const;
 	
 	
 	// Move iterator to first non whitespace character. Comments are considered whitespaces.
@@ -78,34 +315,29 @@ private:
 	void skipComment(detail::IFileIterator & iterator);
 	
 	
-	// Reads something that can be a value (i.e. scalar, block or list) and puts it in output node
-	bool readValue(detail::IFileIterator & iterator, Node & output);
+	// Reads something that can be a value (i.e. scalar, block or list) and reports it
+	bool readValue(detail::IFileIterator & iterator, Handler & handler);
 	
-	// Reads a list into the node
-	bool readList(detail::IFileIterator & iterator, Node & owner);
+	// Reads a list
+	bool readList(detail::IFileIterator & iterator, Handler & handler);
 	
 	// Reads a string checking if it is quoted and running according function
 	bool readScalar(detail::IFileIterator & iterator, std::string & output);
 	
+	// Like above, but output refers to the data. Only strings with escape sequences are copied, into buffer.
+	bool readScalar(detail::IFileIterator & iterator, StringRef & output, std::string & buffer);
+	
 	// Reads a string that can contain most of characters, with notable exception of whitespaces, '#', '=', and brackets
-	bool readNotQuotedScalar(detail::IFileIterator & iterator, std::string & output);
+	bool readNotQuotedScalar(detail::IFileIterator & iterator, StringRef & output);
 	
 	// Reads quoted string. String ends at it's beginning character, eg. "la la la" or ila la lai
-	bool readQuotedScalar(detail::IFileIterator & iterator, std::string & output);
+	bool readQuotedScalar(detail::IFileIterator & iterator, StringRef & output, std::string & buffer);
 	
 	// Parse single node
-	bool readNode(detail::IFileIterator & iterator, Node & parent);
+	bool readNode(detail::IFileIterator & iterator, Handler & handler);
 	
 	// Parse block. If end != 0, skip first char and end at end character.
-	bool readBlock(detail::IFileIterator & iterator, Node & owner, char end = 0);
-	
-	
-	void writeRoot(std::ofstream & file) const;
-	void writeNode(std::ofstream & file, const Node & node, int d=0) const;
-	std::string escapeScalar(const std::string & str) const;
-	
-	
-	
+	bool readBlock(detail::IFileIterator & iterator, Handler & handler, char end = 0);
 	
 	std::string currentPath;
 	std::string errorMsg; // Set if error occured.
@@ -0,0 +1,116 @@
+#include "FeedParser.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+#include "IFileIterator.hpp"
+#include "Scanner.hpp"
+
+using namespace ppk;
+using namespace ppk::detail;
+
+namespace
+{
+
+// Each parse into a tree indexes children of its root again, so ready nodes are parsed in batches
+// growing with the tree. Events can be sent at once.
+const size_t min_batch_size = 1 << 16;
+const size_t batch_divisor = 16;
+
+}
+
+FeedParser::FeedParser(FS & fs, const std::string & name) :
+    fs(&fs),
+    handler(NULL),
+    name(name)
+{
+	reset();
+}
+
+FeedParser::FeedParser(Handler & handler, const std::string & name) :
+    fs(NULL),
+    own_fs(new FS()),
+    handler(&handler),
+    name(name)
+{
+	fs = own_fs.get();
+	reset();
+}
+
+FeedParser::~FeedParser()
+{
+}
+
+bool FeedParser::feed(const char * data, size_t size)
+{
+	if (failed)
+		return false;
+
+	size_t ready = scanner->scan(data, data + size) - parsed;
+	size_t batch = handler ? 1 : std::max<uint64_t>(min_batch_size, parsed / batch_divisor);
+	if (ready < batch)
+	{
+		buffer.append(data, size);
+		return true;
+	}
+
+	// Without older data the chunk is parsed in place
+	if (buffer.empty())
+	{
+		if (!parse(data, ready))
+			return false;
+		buffer.assign(data + ready, data + size);
+	}
+	else
+	{
+		buffer.append(data, size);
+		if (!parse(buffer.data(), ready))
+			return false;
+		buffer.erase(0, ready);
+	}
+	return true;
+}
+
+bool FeedParser::finish()
+{
+	bool result = !failed && (buffer.empty() || parse(buffer.data(), buffer.size()));
+	reset();
+	return result;
+}
+
+const std::string & FeedParser::getError() const
+{
+	return errorMsg;
+}
+
+void FeedParser::reset()
+{
+	scanner.reset(new FeedScanner());
+	buffer.clear();
+	parsed = 0;
+	line = 0;
+	column = 0;
+	failed = false;
+}
+
+bool FeedParser::parse(const char * data, size_t size)
+{
+	fs->currentPath = name;
+
+	IFileIterator it(data, size, parsed, line, column);
+	if (!fs->readChunk(it, handler))
+	{
+		failed = true;
+		errorMsg = fs->errorMsg;
+		return false;
+	}
+
+	// Position after the data, for the next chunk
+	const char * end = data + size;
+	const char * line_begin = std::find(std::reverse_iterator<const char *>(end),
+	                                    std::reverse_iterator<const char *>(data), '\n').base();
+	parsed += size;
+	line += std::count(data, line_begin, '\n');
+	column = line_begin == data ? column + size : end - line_begin;
+	return true;
+}
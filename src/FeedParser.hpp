@@ -0,0 +1,111 @@
+#ifndef _PPK_FEEDPARSER_HPP
+#define _PPK_FEEDPARSER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "FS.hpp"
+#include "Handler.hpp"
+
+
+namespace ppk
+{
+
+namespace detail
+{
+class FeedScanner;
+}
+
+
+
+/**
+ * @brief The FeedParser class parses data which comes in chunks, e.g. from a pipe or a socket.
+ *
+ * Chunks can be split anywhere, even inside a string, an escape sequence or a comment.
+ * The parser keeps its state between them and parses each top-level node as soon as
+ * it is whole, so only the data after the last whole node is kept in memory.
+ * For example:
+ * @code
+ * FS fs;
+ * FeedParser parser(fs);
+ * char chunk[4096];
+ * size_t size;
+ * while ((size = fread(chunk, 1, sizeof(chunk), stdin)) > 0)
+ *     if (!parser.feed(chunk, size))
+ *         break;
+ * if (!parser.finish())
+ *     std::cerr << parser.getError();
+ * @endcode
+ *
+ * The result is the same as if all data was given at once to FS::readBuffer() or FS::parseBuffer(),
+ * including positions in error messages. A top-level node is parsed only when all of it came,
+ * so a single huge node is kept in memory until then.
+ */
+class FeedParser
+{
+public:
+	/**
+	 * @brief Constructs parser which adds top-level nodes to the root of given tree.
+	 *
+	 * Scalars are always copied, as chunks are not needed after feed() returns.
+	 * Lists are packed if FS::setPackedLists() was set. The tree must outlive the parser.
+	 * @param name -- name of the data used in error messages
+	 */
+	explicit FeedParser(FS & fs, const std::string & name = "<feed>");
+
+	/**
+	 * @brief Constructs parser which sends events to given handler, like FS::parse().
+	 *
+	 * The handler must outlive the parser.
+	 * @param name -- name of the data used in error messages
+	 */
+	explicit FeedParser(Handler & handler, const std::string & name = "<feed>");
+
+	/// Noncopyable.
+	FeedParser(const FeedParser &) = delete;
+
+	/// Nonassignable
+	FeedParser & operator=(const FeedParser &) = delete;
+
+	/// Standard destructor. Data after the last whole node is dropped, see finish().
+	~FeedParser();
+
+	/**
+	 * @brief Parses the next chunk of data, as far as it has whole top-level nodes.
+	 *
+	 * The chunk isn't needed after the call returns. After an error nothing is parsed until finish().
+	 * @return true if no errors happened @see getError()
+	 */
+	bool feed(const char * data, size_t size);
+
+	/**
+	 * @brief Parses the rest of the data, which must end there.
+	 *
+	 * Afterwards the parser can be fed new data, which is parsed from its beginning.
+	 * @return true if no errors happened since the beginning of the data @see getError()
+	 */
+	bool finish();
+
+	/// Returns the last error message.
+	const std::string & getError() const;
+
+private:
+	FS * fs;  // Tree being read, or a private one which only parses for the handler
+	std::unique_ptr<FS> own_fs;
+	Handler * handler;  // NULL if the tree is built
+	std::string name;
+	std::unique_ptr<detail::FeedScanner> scanner;
+	std::string buffer;  // Data fed after the last parsed node
+	uint64_t parsed;  // Length of data parsed so far
+	size_t line, column;  // 0-based position after the parsed data
+	bool failed;
+	std::string errorMsg;
+
+	void reset();
+	bool parse(const char * data, size_t size);  // Whole nodes right after the parsed data
+};
+
+}
+
+#endif //_PPK_FEEDPARSER_HPP
@@ -0,0 +1,39 @@
+#include "Handler.hpp"
+
+using namespace ppk;
+
+Handler::~Handler()
+{
+}
+
+void Handler::beginNode(const std::string &, const std::string &)
+{
+}
+
+void Handler::endNode()
+{
+}
+
+void Handler::beginGroup()
+{
+}
+
+void Handler::endGroup()
+{
+}
+
+void Handler::beginList()
+{
+}
+
+void Handler::endList()
+{
+}
+
+void Handler::continueAsList()
+{
+}
+
+void Handler::scalar(const StringRef &)
+{
+}
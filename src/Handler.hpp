@@ -0,0 +1,86 @@
+#ifndef _PPK_HANDLER_HPP
+#define _PPK_HANDLER_HPP
+
+#include <string>
+
+#include "StringRef.hpp"
+
+namespace ppk
+{
+
+/**
+ * @brief The Handler class receives events from the parser instead of a Node tree.
+ *
+ * Derive from it, override the events you need and pass it to FS::parse().
+ * For example this file:
+ * @code
+ * Tree larch { var = 3 }
+ * a = 1, [x]
+ * @endcode
+ * produces these events:
+ * @code
+ * beginNode("Tree", "larch") beginGroup()
+ *     beginNode("var", "") scalar("3") endNode()
+ * endGroup() endNode()
+ * beginNode("a", "") scalar("1") continueAsList()
+ *     beginNode("", "") beginList()
+ *         beginNode("", "") scalar("x") endNode()
+ *     endList() endNode()
+ * endList() endNode()
+ * @endcode
+ *
+ * No more events are sent after a parsing error.
+ * All default implementations do nothing.
+ */
+class Handler
+{
+public:
+	/// Standard destructor.
+	virtual ~Handler();
+
+	/**
+	 * @brief Called at the beginning of every node.
+	 *
+	 * Nodes in lists are unnamed, they have empty name and identifier.
+	 * Value of the node is reported by the next events, until matching endNode().
+	 * A node without any value (e.g. `a;`) is Null.
+	 */
+	virtual void beginNode(const std::string & name, const std::string & identifier);
+
+	/// Called at the end of every node.
+	virtual void endNode();
+
+
+	/// Called when value of the current node is a group, i.e. at '{'.
+	virtual void beginGroup();
+
+	/// Called at the end of the group, i.e. at '}'.
+	virtual void endGroup();
+
+
+	/// Called when value of the current node is a list, i.e. at '['.
+	virtual void beginList();
+
+	/// Called at the end of the list, i.e. at ']' or after last of comma separated values.
+	virtual void endList();
+
+	/**
+	 * @brief Called when value of the current node is followed by a comma, like in `a = 1, 2`.
+	 *
+	 * The value reported so far becomes the first element of a list. Next elements
+	 * are reported as unnamed nodes and endList() is called after the last one.
+	 */
+	virtual void continueAsList();
+
+
+	/**
+	 * @brief Called when value of the current node is a scalar.
+	 *
+	 * The value usually refers to the parsed data, so it is valid only during the call.
+	 */
+	virtual void scalar(const StringRef & value);
+};
+
+}
+
+#endif //_PPK_HANDLER_HPP
@@ -1,71 +1,74 @@
 #include "IFileIterator.hpp"
 
+#include <algorithm>
+
+#include "MappedFile.hpp"
+
 using namespace ppk;
 using namespace ppk::detail;
 
-IFileIterator::IFileIterator(const std::string & path)
+IFileIterator::IFileIterator(const std::string & path) :
+    file(std::make_shared<MappedFile>(path))
 {
-	stream.open(path.c_str());
-	if (!stream.is_open())
-		throw std::runtime_error("cannot open file");
-	current_char = stream.get();
-	line = 1;
-	character = 1;
-	position = 1;
+	begin = file->data();
+	current = begin;
+	end = begin + file->size();
+	first_index = first_line = first_column = 0;
 }
 
-IFileIterator::~IFileIterator()
+IFileIterator::IFileIterator(const char * data, size_t size) :
+    IFileIterator(data, size, 0, 0, 0)
 {
-	stream.close();
 }
 
-void IFileIterator::operator++()
+IFileIterator::IFileIterator(const char * data, size_t size, size_t index, size_t line, size_t column) :
+    begin(data),
+    current(data),
+    end(data + size),
+    first_index(index),
+    first_line(line),
+    first_column(column)
 {
-	++position;
-	++character;
-	if (current_char == '\n')
-	{
-		++line;
-		character = 1;
-	}
-	
-	current_char = stream.get();
 }
 
-void IFileIterator::operator++(int)
+IFileIterator::IFileIterator(const IFileIterator & whole, const char * from, const char * to) :
+    file(whole.file),
+    begin(whole.begin),
+    current(from),
+    end(to),
+    first_index(whole.first_index),
+    first_line(whole.first_line),
+    first_column(whole.first_column)
 {
-	++position;
-	++character;
-	if (current_char == '\n')
-	{
-		++line;
-		character = 1;
-	}
-	
-	current_char = stream.get();
 }
 
-const std::string::value_type & IFileIterator::operator*() const
+IFileIterator::~IFileIterator()
 {
-	return current_char;
 }
 
-bool IFileIterator::isValid() const
+const std::shared_ptr<MappedFile> & IFileIterator::getFile() const
 {
-	return current_char != EOF;
+	return file;
 }
 
-unsigned IFileIterator::getIndex() const
+size_t IFileIterator::getIndex() const
 {
-	return position;
+	return first_index + (current - begin) + 1;
 }
 
-unsigned IFileIterator::getLine() const
+size_t IFileIterator::getLine() const
 {
-	return line;
+	return first_line + std::count(begin, current, '\n') + 1;
 }
 
-unsigned IFileIterator::getChar() const
+size_t IFileIterator::getChar() const
 {
-	return character;
+	const char * line_begin = current;
+	while (line_begin != begin && line_begin[-1] != '\n')
+		--line_begin;
+
+	// The line began in the data before
+	if (line_begin == begin)
+		return first_column + (current - begin) + 1;
+	return current - line_begin + 1;
 }
@@ -1,7 +1,8 @@
 #ifndef _PPK_IFILEITERATOR_HPP
 #define _PPK_IFILEITERATOR_HPP
 
-#include <fstream>
+#include <memory>
+#include <string>
 
 
 namespace ppk
@@ -9,32 +10,85 @@ namespace ppk
 namespace detail
 {
 
-// Very simple iterator, wrapper for ifstream
+class MappedFile;
+
+// Very simple iterator over a range of characters, either the whole contents of a file
+// or a buffer owned by someone else. Line and column are not tracked while moving,
+// they are computed when asked for.
 class IFileIterator
 {
 public:
 	IFileIterator(const std::string & path);
+	IFileIterator(const char * data, size_t size);
+	IFileIterator(const char * data, size_t size, size_t index, size_t line, size_t column);  // Continues data before it, which ended at given 0-based position
+	IFileIterator(const IFileIterator & whole, const char * from, const char * to);  // Part of other range, positions are counted from its beginning
 	IFileIterator(const IFileIterator &) = delete;
 	const IFileIterator & operator=(const IFileIterator &) = delete;
 	~IFileIterator();
-	
+
 	void operator++();
 	void operator++(int);
-	const std::string::value_type & operator*() const;
+	char operator*() const;  // Returns '\0' past the end
 	bool isValid() const;
-	unsigned getIndex() const;
-	unsigned getLine() const;
-	unsigned getChar() const;
+	size_t getIndex() const;
+	size_t getLine() const;
+	size_t getChar() const;
 
-private:
-	char current_char;
-	std::ifstream stream;
+	// Raw access to the range, for scanning many characters at once
+	const char * getCurrent() const;
+	const char * getEnd() const;
+	void setCurrent(const char * position);
 	
-	unsigned position;
-	unsigned line;
-	unsigned character; // Character in current line
+	// Returns the mapped file, NULL if the range is owned by someone else
+	const std::shared_ptr<MappedFile> & getFile() const;
+
+private:
+	std::shared_ptr<MappedFile> file;
+
+	const char * begin;
+	const char * current;
+	const char * end;
+	size_t first_index;  // Position of begin, for data which continues other data
+	size_t first_line;
+	size_t first_column;
 };
 
+
+inline void IFileIterator::operator++()
+{
+	++current;
+}
+
+inline void IFileIterator::operator++(int)
+{
+	++current;
+}
+
+inline char IFileIterator::operator*() const
+{
+	return current != end ? *current : '\0';
+}
+
+inline bool IFileIterator::isValid() const
+{
+	return current != end;
+}
+
+inline const char * IFileIterator::getCurrent() const
+{
+	return current;
+}
+
+inline const char * IFileIterator::getEnd() const
+{
+	return end;
+}
+
+inline void IFileIterator::setCurrent(const char * position)
+{
+	current = position;
+}
+
 }
 }
 
@@ -0,0 +1,53 @@
+#ifndef _PPK_LAZYBODY_HPP
+#define _PPK_LAZYBODY_HPP
+
+#include <memory>
+#include <string>
+
+#include "IFileIterator.hpp"
+
+
+namespace ppk
+{
+namespace detail
+{
+
+class NodePool;
+class StringTable;
+
+// File whose parts are parsed later. Keeps its contents in memory.
+struct LazySource
+{
+	LazySource(const std::string & path, const IFileIterator & whole,
+	           const std::shared_ptr<NodePool> & pool, const std::shared_ptr<StringTable> & table, bool zero_copy, bool packed_lists) :
+	    path(path),
+	    whole(whole, whole.getCurrent(), whole.getEnd()),
+	    pool(pool),
+	    table(table),
+	    zero_copy(zero_copy),
+	    packed_lists(packed_lists)
+	{
+	}
+
+	std::string path;
+	IFileIterator whole;
+	std::shared_ptr<NodePool> pool;  // Pool of the tree, which must keep memory of nodes parsed later
+	std::shared_ptr<StringTable> table;  // Strings of the tree
+	bool zero_copy;  // Scalars refer to the contents, which the FS keeps as long as the nodes
+	bool packed_lists;  // Lists of numbers are packed
+};
+
+// Not parsed contents of a group or list, from its opening bracket to after the closing one
+struct LazyBody
+{
+	std::shared_ptr<const LazySource> source;
+	const char * from;
+	const char * to;
+	std::string error;  // Message of the error found by parsing it, empty if it wasn't parsed yet
+};
+
+}
+}
+
+
+#endif //_PPK_LAZYBODY_HPP
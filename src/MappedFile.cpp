@@ -0,0 +1,102 @@
+#include "MappedFile.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PPK_HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace ppk;
+using namespace ppk::detail;
+
+MappedFile::MappedFile(const std::string & path, bool sequential) :
+    begin(NULL),
+    length(0),
+    mapped(false)
+{
+	if (!map(path, sequential))
+		load(path);
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef PPK_HAVE_MMAP
+	if (mapped)
+		munmap(const_cast<char *>(begin), length);
+#endif
+}
+
+const char * MappedFile::data() const
+{
+	return begin;
+}
+
+size_t MappedFile::size() const
+{
+	return length;
+}
+
+bool MappedFile::isMapped() const
+{
+	return mapped;
+}
+
+bool MappedFile::map(const std::string & path, bool sequential)
+{
+#ifdef PPK_HAVE_MMAP
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("cannot open file");
+
+	// Empty files, pipes and devices cannot be mapped, they are read normally.
+	struct stat st;
+	if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void * address = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+
+	if (address == MAP_FAILED)
+		return false;
+
+	if (sequential)
+		madvise(address, st.st_size, MADV_SEQUENTIAL);
+
+	begin = static_cast<const char *>(address);
+	length = st.st_size;
+	mapped = true;
+	return true;
+#else
+	(void)path;
+	(void)sequential;
+	return false;
+#endif
+}
+
+void MappedFile::load(const std::string & path)
+{
+	FILE * file = fopen(path.c_str(), "rb");
+	if (!file)
+		throw std::runtime_error("cannot open file");
+
+	char chunk[65536];
+	size_t count;
+	while ((count = fread(chunk, 1, sizeof(chunk), file)) > 0)
+		buffer.append(chunk, count);
+
+	bool failed = ferror(file);
+	fclose(file);
+	if (failed)
+		throw std::runtime_error("cannot read file");
+
+	begin = buffer.data();
+	length = buffer.size();
+}
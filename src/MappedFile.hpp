@@ -0,0 +1,40 @@
+#ifndef _PPK_MAPPEDFILE_HPP
+#define _PPK_MAPPEDFILE_HPP
+
+#include <string>
+
+
+namespace ppk
+{
+namespace detail
+{
+
+// Read-only contents of a whole file. Maps it into memory when it is possible,
+// otherwise reads it into a buffer. Sequential files are expected to be read once, from beginning to end.
+class MappedFile
+{
+public:
+	MappedFile(const std::string & path, bool sequential = true);
+	MappedFile(const MappedFile &) = delete;
+	const MappedFile & operator=(const MappedFile &) = delete;
+	~MappedFile();
+
+	const char * data() const;
+	size_t size() const;
+	bool isMapped() const;
+
+private:
+	const char * begin;
+	size_t length;
+	bool mapped;
+	std::string buffer;  // Used when the file cannot be mapped
+
+	bool map(const std::string & path, bool sequential);
+	void load(const std::string & path);
+};
+
+}
+}
+
+
+#endif //_PPK_MAPPEDFILE_HPP
@@ -1,36 +1,131 @@
 #include "Node.hpp"
 
 #include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
 #include <stdexcept>
 #include <algorithm>
+#include <iterator>
 
 #include "utility.hpp"
+#include "FS.hpp"
 #include "IFileIterator.hpp"
+#include "LazyBody.hpp"
 #include "StandardConverters.hpp"
+#include "StringTable.hpp"
 
 using namespace ppk;
 using namespace detail;
 
-Node::Node(const std::string & name, const std::string & identifier) :
+namespace
+{
+
+// Groups at most this big are searched linearly, comparing names by address
+const size_t linear_search_size = 8;
+
+// Trees can have millions of nodes, so on 64-bit platforms a node without children takes one cache line.
+static_assert(sizeof(void *) != 8 || sizeof(Node) <= 64, "Node should take at most 64 bytes");
+
+// Name or identifier of a node which isn't in any StringTable. It is shared only if it is empty.
+const InternedString * emptyString()
+{
+	static const InternedString empty = {"", NULL};
+	return &empty;
+}
+
+const InternedString * own(const std::string & str)
+{
+	return str.empty() ? emptyString() : new InternedString{str, NULL};
+}
+
+void release(const InternedString * str)
+{
+	if (!str->table && str != emptyString())
+		delete str;
+}
+
+}
+
+// Orders nodes in block by name. It is used by every search, so it reads names without calls.
+struct detail::NameLess
+{
+	bool operator()(const Node * a, const Node * b) const
+	{
+		return a->name->str < b->name->str;
+	}
+	
+	bool operator()(const Node * a, const std::string & b) const
+	{
+		return a->name->str < b;
+	}
+	
+	bool operator()(const std::string & a, const Node * b) const
+	{
+		return a < b->name->str;
+	}
+	
+	// Interned strings are equal only if they are the same object
+	bool operator()(const Node * a, const InternedString * b) const
+	{
+		return a->name != b && a->name->str < b->str;
+	}
+	
+	bool operator()(const InternedString * a, const Node * b) const
+	{
+		return a != b->name && a->str < b->name->str;
+	}
+};
+
+Node::Node(const std::string & name, const std::string & identifier)
+{
+	if (name.empty() && !identifier.empty())
+		throw std::domain_error("Nodes must have name before they could have an identifier!");
+	
+	this->name = own(name);
+	this->identifier = own(identifier);
+	
+	type = Type::Null;
+	
+	parent = NULL;
+	children = NULL;
+	scalar = "";
+	scalar_size = 0;
+	owns_scalar = false;
+	source = 0;
+	pooled = false;
+	changed = false;
+	resetCache();
+}
+
+Node::Node(const InternedString * name, const InternedString * identifier) :
     name(name),
     identifier(identifier)
 {
-	if (name.empty() && !identifier.empty())
+	if (name->str.empty() && !identifier->str.empty())
 		throw std::domain_error("Nodes must have name before they could have an identifier!");
 	
 	type = Type::Null;
 	
 	parent = NULL;
+	children = NULL;
+	scalar = "";
+	scalar_size = 0;
+	owns_scalar = false;
+	source = 0;
+	pooled = false;
+	changed = false;
+	resetCache();
 }
 
 Node::~Node()
 {
-	for (auto & it : block_index)
-		delete it;
-	
-	block.clear();
-	block_index.clear();
+	deleteChildren();
+	releaseScalar();
 	parent = NULL;
+	
+	release(name);
+	release(identifier);
 }
 
 Node::Type Node::getType() const
@@ -39,28 +134,42 @@ Node::Type Node::getType() const
 }
 
 void Node::insert(Node * child)
+{
+	prepare();
+	append(child);
+	touch();
+	
+	// After all children of the same name
+	block_type & block = children->block;
+	block.insert(std::upper_bound(block.begin(), block.end(), child, NameLess()), child);
+}
+
+void Node::append(Node * child)
 {
 	if (!child->isRoot())
 		throw std::domain_error("This node has got already parent!");
 	
 	if (type == Type::Scalar)
 		throw std::domain_error("You cannot add nodes to scalars!");
-	if (type == Type::List && (!child->name.empty() || !child->identifier.empty()))
+	if (type == Type::List && (child->hasName() || child->hasIdentifier()))
 		throw std::domain_error("Children in lists cannot have names nor identifiers!");
-	if (type == Type::Group && child->name.empty())
+	if (type == Type::Group && !child->hasName())
 		throw std::domain_error("In a group everything must have a name!");
 	
 	if (type == Type::Null)
 	{
-		if (child->name.empty())
+		if (!child->hasName())
 			type = Type::List;
 		else
 			type = Type::Group;
 	}
 	
-	block_index.push_back(child);
-	block.insert(std::make_pair(child->name, child));
+	makeChildren().block_index.push_back(child);
 	child->parent = this;
+	
+	// Children must use the same strings as their parent, so that they can be found by address
+	if (name->table && child->name->table != name->table)
+		child->intern(*name->table);
 }
 
 Node &Node::emplace(const std::string & name, const std::string & identifier)
@@ -83,20 +192,46 @@ void Node::setIdentifier(const std::string & value)
 	if (!hasName())
 		throw std::domain_error("Nodes must have name before they could have an identifier!");
 	
-	identifier = value;
+	const InternedString * old = identifier;
+	identifier = name->table ? name->table->intern(value) : own(value);
+	release(old);
+	touch();
 }
 
 void Node::setScalar(const std::string & value)
+{
+	assignScalar(value, true);
+	touch();
+}
+
+void Node::assignScalar(const StringRef & value, bool copy)
 {
 	if (type == Type::Group)
 		throw std::domain_error("Groups cannot have values!");
 	if (type == Type::List)
 		throw std::domain_error("Lists cannot have values!");
 	
+	if (value.size() > std::numeric_limits<uint32_t>::max())
+		throw std::length_error("Scalars can't be longer than 4 GiB!");
+	
 	if (type == Type::Null)
 		type = Type::Scalar;
 	
-	scalar = value;
+	resetCache();
+	
+	// Copied before releasing, as the value can be the current scalar
+	const char * data = value.data();
+	if (copy && !value.empty())
+	{
+		char * buffer = new char[value.size()];
+		memcpy(buffer, value.data(), value.size());
+		data = buffer;
+	}
+	
+	releaseScalar();
+	scalar = copy && value.empty() ? "" : data;
+	scalar_size = value.size();
+	owns_scalar = copy && !value.empty();
 }
 
 const char * Node::operator=(const char * value)
@@ -108,19 +243,17 @@ const char * Node::operator=(const char * value)
 
 void Node::removePtr(Node * child)
 {
-	block_index.erase(std::remove(block_index.begin(), block_index.end(), child), block_index.end());
+	prepare();
 	
-	std::pair<block_type::iterator, block_type::iterator> ret = block.equal_range(child->getName());
-	for (detail::block_type::iterator iter = ret.first; iter != ret.second;)
-	{
-		auto erased = iter++;
-		if (erased->second == child)
-		{
-			block.erase(erased);
-			delete child;
-			break;
-		}
-	}
+	block_index_type & block_index = getIndex();
+	auto it = std::find(block_index.begin(), block_index.end(), child);
+	if (it == block_index.end())
+		return;
+	
+	touch();
+	block_index.erase(it);
+	children->block.erase(std::find(children->block.begin(), children->block.end(), child));
+	dispose(child);
 }
 
 void Node::remove(unsigned index)
@@ -135,45 +268,57 @@ void Node::remove(const std::string & name)
 
 void Node::removeAll()
 {
-	for (auto & it : block_index)
-		delete it;
-	
-	block.clear();
-	block_index.clear();
+	touch();
+	deleteChildren();
 }
 
 void Node::removeOnly(const std::string & name)
 {
+	prepare();
+	if (!children || count(name) == 0)
+		return;
+	
+	touch();
+	block_index_type & block_index = children->block_index;
 	block_index.erase(std::remove_if( block_index.begin(), block_index.end(), 
 	                                  [&name](Node * x){return x->getName() == name;}), block_index.end());
 	
-	for (auto & it : only(name))
-		delete &it;
+	// Disposed after leaving the block, as finding them there compares their names
+	block_type & block = children->block;
+	auto ret = std::equal_range(block.begin(), block.end(), name, NameLess());
+	block_type removed(ret.first, ret.second);
+	block.erase(ret.first, ret.second);
 	
-	block.erase(name);
+	for (Node * node : removed)
+		dispose(node);
 }
 
 void Node::clear()
 {
-	for (auto & it : block_index)
-		delete it;
-	
-	block.clear();
-	block_index.clear();
+	touch();
+	reset();
+}
+
+void Node::reset()
+{
+	deleteChildren();
 	
+	releaseScalar();
 	scalar = "";
+	scalar_size = 0;
+	resetCache();
 	
 	type = Type::Null;
 }
 
 bool Node::hasName() const
 {
-	return !name.empty();
+	return !name->str.empty();
 }
 
 bool Node::hasIdentifier() const
 {
-	return !identifier.empty();
+	return !identifier->str.empty();
 }
 
 bool Node::isRoot() const
@@ -183,12 +328,12 @@ bool Node::isRoot() const
 
 const std::string & Node::getName() const
 {
-	return name;
+	return name->str;
 }
 
 const std::string & Node::getIdentifier() const
 {
-	return identifier;
+	return identifier->str;
 }
 
 Node *Node::getParent()
@@ -201,34 +346,38 @@ const Node *Node::getParent() const
 	return parent;
 }
 
-const std::string & Node::getScalar() const
+StringRef Node::getScalar() const
 {
-	return scalar;
+	return StringRef(scalar, scalar_size);
 }
 
 unsigned Node::count(const std::string & name) const
 {
-	return block.count(name);
+	prepare();
+	auto ret = findName(name);
+	return ret.second - ret.first;
 }
 
 Node & Node::operator[](const std::string & name)
 {
-	std::pair<block_type::iterator, block_type::iterator> ret = block.equal_range(name);
+	prepare();
+	Node * last = findLast(name);
 	
-	if (ret.first == ret.second)
+	if (!last)
 		throw std::out_of_range("There is no such key as " + name + " in node " + getName() + (!hasIdentifier() ? " " + getIdentifier() : "") + "!");
 	
-	return *((--(ret.second))->second);
+	return *last;
 }
 
 const Node & Node::operator[](const std::string & name) const
 {
-	std::pair<block_type::const_iterator, block_type::const_iterator> ret = block.equal_range(name);
+	prepare();
+	Node * last = findLast(name);
 	
-	if (ret.first == ret.second)
+	if (!last)
 		throw std::out_of_range("There is no such key as " + name + " in node " + getName() + (!hasIdentifier() ? " " + getIdentifier() : "") + "!");
 	
-	return *((--(ret.second))->second);
+	return *last;
 }
 
 std::string Node::operator()(const std::string & name, const char * default_val) const
@@ -241,94 +390,126 @@ std::string Node::operator()(const std::string & name, const char * default_val)
 
 Node &Node::operator[](unsigned index)
 {
-	if (index < block_index.size())
-		return *block_index[index];
+	prepare();
+	if (index < getIndex().size())
+		return *getIndex()[index];
 	
-	throw std::out_of_range("There are only " + detail::to_string(block_index.size()) + " subnodes in node " + 
-	                        name + (!identifier.empty() ? " " + identifier : "") + "! (Requested index: " + detail::to_string(index) + ")"
+	throw std::out_of_range("There are only " + detail::to_string(getIndex().size()) + " subnodes in node " + 
+	                        getName() + (hasIdentifier() ? " " + getIdentifier() : "") + "! (Requested index: " + detail::to_string(index) + ")"
 	                        );
 }
 
 const Node &Node::operator[](unsigned index) const
 {
-	if (index < block_index.size())
-		return *block_index[index];
+	prepare();
+	if (index < getIndex().size())
+		return *getIndex()[index];
 	
-	throw std::out_of_range("There are less subnodes than " + detail::to_string(index) + " in node " + name + (!identifier.empty() ? " " + identifier : "") + "!");
+	throw std::out_of_range("There are less subnodes than " + detail::to_string(index) + " in node " + getName() + (hasIdentifier() ? " " + getIdentifier() : "") + "!");
 }
 
 IteratorReturner<NodeIter> Node::all()
 {
-	return IteratorReturner<NodeIter>(block_index.begin(), block_index.end());
+	prepare();
+	return IteratorReturner<NodeIter>(getIndex().begin(), getIndex().end());
 }
 
 IteratorReturner<CNodeIter > Node::all() const
 {
-	return IteratorReturner<CNodeIter>(block_index.begin(), block_index.end());
+	prepare();
+	return IteratorReturner<CNodeIter>(getIndex().begin(), getIndex().end());
 }
 
 IteratorReturner<RNodeIter> Node::rall()
 {
-	return IteratorReturner<RNodeIter>(block_index.end(), block_index.begin());
+	prepare();
+	return IteratorReturner<RNodeIter>(getIndex().end(), getIndex().begin());
 }
 
 IteratorReturner<CRNodeIter> Node::rall() const
 {
-	return IteratorReturner<CRNodeIter>(block_index.end(), block_index.begin());
+	prepare();
+	return IteratorReturner<CRNodeIter>(getIndex().end(), getIndex().begin());
 }
 
 IteratorReturner<NodeSortedIter> Node::only(const std::string & name)
 {
-	std::pair<block_type::iterator, block_type::iterator> ret = block.equal_range(name);
+	prepare();
+	auto ret = findName(name);
 	return IteratorReturner<NodeSortedIter>(ret.first, ret.second);
 }
 
 IteratorReturner<CNodeSortedIter> Node::only(const std::string & name) const
 {
-	std::pair<block_type::const_iterator, block_type::const_iterator> ret = block.equal_range(name);
+	prepare();
+	auto ret = findName(name);
 	return IteratorReturner<CNodeSortedIter>(ret.first, ret.second);
 }
 
 IteratorReturner<RNodeSortedIter> Node::ronly(const std::string & name)
 {
-	std::pair<block_type::iterator, block_type::iterator> ret = block.equal_range(name);
+	prepare();
+	auto ret = findName(name);
 	return IteratorReturner<RNodeSortedIter>(ret.second, ret.first);
 }
 
 IteratorReturner<CRNodeSortedIter> Node::ronly(const std::string & name) const
 {
-	std::pair<block_type::const_iterator, block_type::const_iterator> ret = block.equal_range(name);
+	prepare();
+	auto ret = findName(name);
 	return IteratorReturner<CRNodeSortedIter>(ret.second, ret.first);
 }
 
 IteratorReturner<NodeSortedIter> Node::sorted()
 {
-	return IteratorReturner<NodeSortedIter>(block.begin(), block.end());
+	prepare();
+	return IteratorReturner<NodeSortedIter>(getBlock().begin(), getBlock().end());
 }
 
 IteratorReturner<CNodeSortedIter> Node::sorted() const
 {
-	return IteratorReturner<CNodeSortedIter>(block.begin(), block.end());
+	prepare();
+	return IteratorReturner<CNodeSortedIter>(getBlock().begin(), getBlock().end());
 }
 
 IteratorReturner<RNodeSortedIter> Node::rsorted()
 {
-	return IteratorReturner<RNodeSortedIter>(block.end(), block.begin());
+	prepare();
+	return IteratorReturner<RNodeSortedIter>(getBlock().end(), getBlock().begin());
 }
 
 IteratorReturner<CRNodeSortedIter> Node::rsorted() const
 {
-	return IteratorReturner<CRNodeSortedIter>(block.end(), block.begin());
+	prepare();
+	return IteratorReturner<CRNodeSortedIter>(getBlock().end(), getBlock().begin());
 }
 
 bool Node::hasKey(const std::string & name) const
 {
-	return block.find(name) != block.end();
+	prepare();
+	return findLast(name) != NULL;
 }
 
 unsigned Node::size() const
 {
-	return block_index.size();
+	// Packed numbers are counted without making their nodes
+	if (getBody())
+		FS::expand(const_cast<Node &>(*this));
+	if (getPacked())
+		return getPacked()->size();
+	return getIndex().size();
+}
+
+template <>
+void Node::extract<bool>(const std::list<size_t> & dimensions, std::vector<bool> & out) const
+{
+	size_t count = 1;
+	for (auto & size : dimensions)
+		count *= size;
+	
+	std::unique_ptr<bool[]> values(new bool[count]);
+	extract(dimensions, values.get());
+	out.assign(values.get(), values.get() + count);
 }
 
 bool Node::hasDimensions(const std::list<size_t> & dimensions) const
@@ -356,9 +537,9 @@ void Node::print(int d) const
 	for (int i = 0; i < d; i++)
 		printf("\t");
 	if (hasIdentifier())
-		printf("%s \"%s\"= %s\n", getName().c_str(), getIdentifier().c_str(), getScalar().c_str());
+		printf("%s \"%s\"= %.*s\n", getName().c_str(), getIdentifier().c_str(), static_cast<int>(scalar_size), scalar);
 	else
-		printf("%s = %s\n", getName().c_str(), getScalar().c_str());
+		printf("%s = %.*s\n", getName().c_str(), static_cast<int>(scalar_size), scalar);
 	
 	for (auto & it : all())
 	{
@@ -366,21 +547,265 @@ void Node::print(int d) const
 	}
 }
 
-void Node::shake()
+void Node::takeChildren(Node & from)
+{
+	for (auto & child : from.getIndex())
+	{
+		child->parent = NULL;
+		append(child);
+	}
+	indexChildren();
+	
+	// Only the list is deleted, the children belong to this node now
+	delete from.children;
+	from.children = NULL;
+	from.type = Type::Null;
+}
+
+void Node::spliceChildren(Node & from, const std::function<bool(const Node *)> & remove,
+                          const std::function<bool(const Node *, const Node *)> & before)
 {
-	Node * node = new Node;
+	makeChildren();
+	indexChildren();
+	from.indexChildren();
+	
+	block_index_type & block_index = children->block_index;
+	block_type & block = children->block;
 	
+	block_index_type removed;
+	for (auto & child : block_index)
+		if (remove(child))
+			removed.push_back(child);
+	
+	if (!removed.empty())
+	{
+		block_index.erase(std::remove_if(block_index.begin(), block_index.end(), remove), block_index.end());
+		block.erase(std::remove_if(block.begin(), block.end(), remove), block.end());
+	}
+	
+	if (from.children)
+	{
+		if (type == Type::Null)
+			type = Type::Group;
+		for (auto & child : from.children->block_index)
+			child->parent = this;
+		
+		// One pass over both lists instead of sorting everything again
+		block_index_type merged;
+		merged.reserve(block_index.size() + from.children->block_index.size());
+		std::merge(block_index.begin(), block_index.end(), from.children->block_index.begin(),
+		           from.children->block_index.end(), std::back_inserter(merged), before);
+		block_index.swap(merged);
+		
+		NameLess less;
+		merged.clear();
+		std::merge(block.begin(), block.end(), from.children->block.begin(), from.children->block.end(),
+		           std::back_inserter(merged), [&](const Node * a, const Node * b)
+		{
+			return less(a, b) || (!less(b, a) && before(a, b));
+		});
+		block.swap(merged);
+		
+		// Only the list is deleted, the children belong to this node now
+		delete from.children;
+		from.children = NULL;
+		from.type = Type::Null;
+	}
+	
+	for (auto & child : removed)
+		dispose(child);
+}
+
+void Node::indexChildren()
+{
+	if (!children)
+		return;
+	
+	// Children of the same name are already in chronological order, so merging keeps it.
+	block_type & block = children->block;
+	block_index_type & block_index = children->block_index;
+	size_t indexed = block.size();
+	if (indexed == block_index.size())
+		return;
+	
+	block.insert(block.end(), block_index.begin() + indexed, block_index.end());
+	std::stable_sort(block.begin() + indexed, block.end(), NameLess());
+	std::inplace_merge(block.begin(), block.begin() + indexed, block.end(), NameLess());
+}
+
+std::pair<block_type::const_iterator, block_type::const_iterator> Node::findName(const std::string & key) const
+{
+	const block_type & block = getBlock();
+	
+	if (!name->table)
+		return std::equal_range(block.begin(), block.end(), key, NameLess());
+	
+	// All children use the same table, so if the name isn't there, there is no such child.
+	const InternedString * interned = name->table->find(key);
+	if (!interned)
+		return std::make_pair(block.end(), block.end());
+	
+	if (block.size() > linear_search_size)
+		return std::equal_range(block.begin(), block.end(), interned, NameLess());
+	
+	auto first = block.begin();
+	while (first != block.end() && (*first)->name != interned)
+		++first;
+	
+	auto last = first;
+	while (last != block.end() && (*last)->name == interned)
+		++last;
+	
+	return std::make_pair(first, last);
+}
+
+Node * Node::findLast(const std::string & key) const
+{
+	const block_type & block = getBlock();
+	if (!name->table)
+	{
+		auto ret = findName(key);
+		return ret.first != ret.second ? ret.second[-1] : NULL;
+	}
+	
+	const InternedString * interned = name->table->find(key);
+	if (!interned)
+		return NULL;
+	
+	// One search is enough, the last child of the name is right before the first greater one.
+	auto last = std::upper_bound(block.begin(), block.end(), interned, NameLess());
+	return last != block.begin() && last[-1]->name == interned ? last[-1] : NULL;
+}
+
+void Node::intern(StringTable & table)
+{
+	const InternedString * old_name = name, * old_identifier = identifier;
+	name = table.intern(old_name->str);
+	identifier = table.intern(old_identifier->str);
+	release(old_name);
+	release(old_identifier);
+	
+	for (auto & child : getIndex())
+		child->intern(table);
+}
+
+void Node::prepare() const
+{
+	if (getBody())
+		FS::expand(const_cast<Node &>(*this));
+	if (getPacked())
+		const_cast<Node &>(*this).unpack();
+}
+
+void Node::unpack()
+{
+	std::unique_ptr<PackedList> numbers(children->packed);
+	children->packed = NULL;
+	
+	const InternedString * empty = name->table ? name->table->intern("") : emptyString();
+	char text[PackedList::text_size];
+	
+	children->block_index.reserve(numbers->size());
+	for (size_t i = 0; i < numbers->size(); i++)
+	{
+		Node * child = new Node(empty, empty);
+		child->assignScalar(StringRef(text, numbers->format(i, text)), true);
+		append(child);
+	}
+	indexChildren();
+}
+
+void Node::touch()
+{
+	Node * node = this;
+	while (node->parent && node->parent->parent)
+		node = node->parent;
+	node->changed = true;
+}
+
+void Node::resetCache()
+{
+	// Nodes are never changed while other threads read them, so it can't be mixed with storing.
+	cache_state.store(0, std::memory_order_relaxed);
+	cache.store(0, std::memory_order_relaxed);
+}
+
+void Node::dispose(Node * node)
+{
+	if (node->pooled)
+		node->~Node();
+	else
+		delete node;
+}
+
+void Node::shake(Node * node)
+{
 	node->type = type;
 	type = Type::Null;
 	
 	node->scalar = scalar;
+	node->scalar_size = scalar_size;
+	node->owns_scalar = owns_scalar;
 	scalar = "";
+	scalar_size = 0;
+	owns_scalar = false;
+	resetCache();
 	
-	node->block = block;
-	block.clear();
+	node->children = children;
+	children = NULL;
+	for (auto & child : node->getIndex())
+		child->parent = node;
 	
-	node->block_index = block_index;
-	block_index.clear();
+	// The only child, inserted without marking the node as changed
+	append(node);
+	children->block.push_back(node);
+}
+
+Children & Node::makeChildren()
+{
+	if (!children)
+		children = new Children{block_type(), block_index_type(), NULL, NULL};
+	return *children;
+}
+
+block_index_type & Node::getIndex() const
+{
+	// Shared by all nodes without children, it is always empty
+	static block_index_type none;
+	return children ? children->block_index : none;
+}
+
+block_type & Node::getBlock() const
+{
+	return children ? children->block : getIndex();
+}
+
+LazyBody * Node::getBody() const
+{
+	return children ? children->body : NULL;
+}
+
+PackedList * Node::getPacked() const
+{
+	return children ? children->packed : NULL;
+}
+
+void Node::deleteChildren()
+{
+	if (!children)
+		return;
 	
-	insert(node);
+	for (auto & child : children->block_index)
+		dispose(child);
+	delete children->body;
+	delete children->packed;
+	delete children;
+	children = NULL;
+}
+
+void Node::releaseScalar()
+{
+	if (owns_scalar)
+		delete[] scalar;
+	owns_scalar = false;
 }
@@ -1,19 +1,53 @@
 #ifndef _PPK_NODE_HPP
 #define	_PPK_NODE_HPP
 
+#include <atomic>
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <map>
 #include <list>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
 
 #include "NodeIterators.hpp"
+#include "PackedList.hpp"
+#include "StringRef.hpp"
 
 namespace ppk
 {
 
 class FS;
 
+namespace detail {
+class TreeBuilder;
+class BinaryReader;
+class TextWriter;
+class NodePool;
+class StringTable;
+struct LazyBody;
+struct InternedString;
+struct NameLess;
+
+// Children of a group or list, allocated only by nodes which have any
+struct Children
+{
+	block_type block;
+	block_index_type block_index;
+	LazyBody * body;  // Children which are not parsed yet, NULL if there are none
+	PackedList * packed;  // Numbers kept instead of children until they are needed, NULL if there are none
+};
+}
+
 /**
  * @brief The Converter is a class you should specialise for any type you want read or write.
+ * 
+ * Its members can be specialised one by one. A full specialisation of the class can also have
+ * an optional member `static bool fromString(const StringRef & str, Type & out)`, which converts
+ * a scalar and returns true if it succeeded. Read-only views, like NodeView, use it to convert
+ * scalars without making a Node, and use fromNode() with a temporary Node if it isn't defined.
+ * 
  * @tparam Type tells for which type is the converter
  */
 template <class Type>
@@ -50,6 +84,11 @@ public:
 class Node  // TODO It should remember it's file and line
 {
 	friend class ppk::FS;
+	friend class ppk::detail::TreeBuilder;
+	friend class ppk::detail::BinaryReader;
+	friend class ppk::detail::TextWriter;
+	friend class ppk::detail::NodePool;
+	friend struct ppk::detail::NameLess;
 	
 public:
 	// --------- CONSTRUCTORS &c. --------- //
@@ -75,16 +114,16 @@ public:
 	/**
 	 * @brief Standard destructor.
 	 * 
-	 * Deletes all children of the Node.
+	 * Deletes all children of the Node. It isn't virtual, Node is not meant to be derived from.
 	 */
-	virtual ~Node();
+	~Node();
 	
 	
 	// -------------- ABOUT -------------- //
 	/**
 	 * @brief The type of Node
 	 */
-	enum class Type
+	enum class Type : uint8_t
 	{
 		Null,  ///< Empty node, can become anything
 		Scalar,  ///< Contains a scalar
@@ -153,10 +192,11 @@ public:
 	 * @brief Returns contained scalar.
 	 * 
 	 * Returns a string as read from file. Its main use is in Converter%s.
+	 * It refers to the data read with FS::setZeroCopy() and to the node otherwise.
 	 * 
 	 * @return "" if it is not Scalar.
 	 */
-	const std::string & getScalar() const;
+	StringRef getScalar() const;
 	
 	
 	/**
@@ -167,6 +207,10 @@ public:
 	
 	/**
 	 * @brief Converts scalar to given type.
+	 * 
+	 * The last successful conversion to an arithmetic type (except long double) is cached
+	 * until the scalar changes, so converting it again to the same type is cheap.
+	 * 
 	 * @throws std::invalid_argument when conversion failed.
 	 */
 	template <class T> T as() const;
@@ -178,6 +222,27 @@ public:
 	template <class T> operator T() const;
 	
 	
+	/**
+	 * @brief Converts a hypercube of scalars (see hasDimensions()) to a contiguous array, in row-major order.
+	 * 
+	 * Dimensions are checked while converting, so the array can be partly filled when it throws.
+	 * 
+	 * @param dimensions -- sizes of the node, its children, their children and so on; the last level are scalars
+	 * @param out -- array for as many values as product of the dimensions
+	 * @throws std::invalid_argument when the node has other dimensions or a scalar can't be converted.
+	 */
+	template <class T> void extract(const std::list<size_t> & dimensions, T * out) const;
+	
+	/**
+	 * @brief Converts a hypercube of scalars to a vector, in row-major order.
+	 * 
+	 * The vector is resized to product of the dimensions.
+	 * 
+	 * @see extract()
+	 */
+	template <class T> void extract(const std::list<size_t> & dimensions, std::vector<T> & out) const;
+	
+	
 	/**
 	 * @brief Returns the last child of given name
 	 * @throws std::out_of_range if there is no such child
@@ -374,17 +439,57 @@ public:
 	void print(int d = 0) const;
 	
 private:
-	Type type;
-	
-	const std::string name;
-	std::string identifier;
-	std::string scalar;
-	
+	// Members are ordered by size, so that there is no padding. There can be millions of nodes.
+	const detail::InternedString * name;  // Shared with other nodes of the tree, so that names are compared by address
+	const detail::InternedString * identifier;
 	Node * parent;
-	detail::block_type block;
-	detail::block_index_type block_index;
-	
-	void shake();  // creates anonymous child and gives it all parent's content. It is helper method for Parser.
+	detail::Children * children;  // NULL if there are none
+	const char * scalar;  // Owned by the node or refers to data read by FS
+	mutable std::atomic<uint64_t> cache;  // Bits of the cached value
+	mutable std::atomic<uint32_t> cache_state;  // Tag of the type of cached conversion in the lowest byte, number of stores above
+	uint32_t scalar_size;
+	unsigned source;  // Index of file in FS plus one, 0 if not read from file. Used only in top-level nodes.
+	Type type;
+	bool owns_scalar;  // scalar was allocated by the node
+	bool pooled;  // Created by NodePool, so it is only destroyed instead of deleted
+	bool changed;  // Modified since its file was read or written by FS. Used only in top-level nodes.
+	
+	Node(const detail::InternedString * name, const detail::InternedString * identifier);
+	
+	detail::Children & makeChildren();  // allocates children if there are none
+	detail::block_index_type & getIndex() const;  // children in chronological order. Must not be modified if there are no children.
+	detail::block_type & getBlock() const;  // children sorted by name. Must not be modified if there are no children.
+	detail::LazyBody * getBody() const;
+	detail::PackedList * getPacked() const;
+	void deleteChildren();
+	void releaseScalar();
+	void touch();  // marks its top-level ancestor as changed
+	void reset();  // like clear(), but doesn't mark the node as changed
+	
+	void intern(detail::StringTable & table);  // moves name and identifier of the whole subtree to the table
+	void prepare() const;  // parses children if they are not parsed yet, and makes nodes of packed numbers
+	void unpack();  // makes nodes of packed numbers
+	void append(Node * child);  // inserts child, but doesn't add it to block. Used when many children are inserted at once.
+	void indexChildren();  // adds appended children to block
+	std::pair<detail::block_type::const_iterator, detail::block_type::const_iterator> findName(const std::string & key) const;
+	Node * findLast(const std::string & key) const;  // last child of given name, NULL if there is none
+	void assignScalar(const StringRef & value, bool copy);  // like setScalar(), but if the value isn't copied it must outlive the node
+	void shake(Node * child);  // gives all content to the new anonymous child and inserts it. It is helper method for Parser.
+	static void dispose(Node * node);  // deletes or destroys node, depending on how it was created
+	void takeChildren(Node & from);  // moves all children of the other node to the end of this one
+	// Disposes children for which remove returns true and takes all children of the other node. Both are
+	// ordered by before, so they are merged, and children of the same name stay in that order too.
+	void spliceChildren(Node & from, const std::function<bool(const Node *)> & remove,
+	                    const std::function<bool(const Node *, const Node *)> & before);
+
+	template <class T> bool convert(T & out) const;  // converts scalar using the cache if possible
+	template <class T> bool convert(T & out, std::false_type cached) const;
+	template <class T> bool convert(T & out, std::true_type cached) const;
+	void resetCache();
+	template <class T> bool extract(std::list<size_t>::const_iterator it,  // helper for extract(), moves out past written values
+	                                std::list<size_t>::const_iterator end, T * & out) const;
+	template <class T> bool extractScalars(T * & out, std::true_type numeric) const;  // the last level of extract()
+	template <class T> bool extractScalars(T * & out, std::false_type numeric) const;
 
 	bool hasDimensions(std::list<size_t>::const_iterator it,         // helper for hasDimensions()
 	                   std::list<size_t>::const_iterator end) const;
@@ -1,24 +1,59 @@
 #ifndef NODE_TPP
 #define NODE_TPP
 
+#include <cstring>
+
 
 namespace ppk
 {
 
+///@cond PRIVATE
+namespace detail
+{
+
+// Types whose conversions are cached in nodes, with their tags. Values must fit in 8 bytes.
+template <class T> struct CacheTag : std::integral_constant<uint32_t, 0> {};
+
+#define PPK_DEFINE_CACHE_TAG(Type, tag)\
+	template <> struct CacheTag<Type> : std::integral_constant<uint32_t, tag> {};
+
+PPK_DEFINE_CACHE_TAG(bool, 1)
+PPK_DEFINE_CACHE_TAG(int, 2)
+PPK_DEFINE_CACHE_TAG(short, 3)
+PPK_DEFINE_CACHE_TAG(long, 4)
+PPK_DEFINE_CACHE_TAG(long long, 5)
+PPK_DEFINE_CACHE_TAG(unsigned, 6)
+PPK_DEFINE_CACHE_TAG(unsigned short, 7)
+PPK_DEFINE_CACHE_TAG(unsigned long, 8)
+PPK_DEFINE_CACHE_TAG(unsigned long long, 9)
+PPK_DEFINE_CACHE_TAG(char, 10)
+PPK_DEFINE_CACHE_TAG(signed char, 11)
+PPK_DEFINE_CACHE_TAG(unsigned char, 12)
+PPK_DEFINE_CACHE_TAG(float, 13)
+PPK_DEFINE_CACHE_TAG(double, 14)
+
+#undef PPK_DEFINE_CACHE_TAG
+
+const uint32_t cache_tag_mask = 0xff;
+const uint32_t cache_busy = 0xff;  // Tag while a thread stores a value
+
+}
+///@endcond
+
 
 template <class T>
 bool Node::is() const
 {
 	T t;
-	return Converter<T>::fromNode(*this, t);
+	return convert(t);
 }
 
 template <class T>
 T Node::as() const
 {
 	T t;
-	if (!Converter<T>::fromNode(*this, t))
-		throw std::invalid_argument(name + (identifier.empty() ? "" : " " + identifier) + " is not " + Converter<T>::type_name + "!");
+	if (!convert(t))
+		throw std::invalid_argument(getName() + (hasIdentifier() ? " " + getIdentifier() : "") + " is not " + Converter<T>::type_name + "!");
 	return t;
 }
 
@@ -39,6 +74,119 @@ T Node::operator()(const std::string & name, const T & default_val) const
 }
 
 
+template <class T>
+void Node::extract(const std::list<size_t> & dimensions, T * out) const
+{
+	if (dimensions.empty() || !extract(dimensions.cbegin(), dimensions.cend(), out))
+		throw std::invalid_argument(getName() + (hasIdentifier() ? " " + getIdentifier() : "") + " is not a hypercube of "
+		                            + Converter<T>::type_name + " of given dimensions!");
+}
+
+template <class T>
+void Node::extract(const std::list<size_t> & dimensions, std::vector<T> & out) const
+{
+	size_t count = 1;
+	for (auto & size : dimensions)
+		count *= size;
+	
+	out.resize(count);
+	extract(dimensions, out.data());
+}
+
+// Bits of std::vector<bool> can't be written through a pointer, so they are converted separately
+template <>
+void Node::extract<bool>(const std::list<size_t> & dimensions, std::vector<bool> & out) const;
+
+template <class T>
+bool Node::extract(std::list<size_t>::const_iterator it, std::list<size_t>::const_iterator end, T * & out) const
+{
+	if (size() != *it)
+		return false;
+	
+	// Only standard numeric types can be converted from packed lists without nodes
+	if (++it == end)
+		return extractScalars(out, std::integral_constant<bool, (detail::CacheTag<T>::value > 0)>());
+	
+	for (auto & child : all())
+		if (!child.extract(it, end, out))
+			return false;
+	
+	return true;
+}
+
+template <class T>
+bool Node::extractScalars(T * & out, std::true_type) const
+{
+	const detail::PackedList * packed = getPacked();
+	if (!packed)
+		return extractScalars(out, std::false_type());
+	
+	for (size_t i = 0; i < packed->size(); i++)
+		if (!packed->get(i, *out++))
+			return false;
+	
+	return true;
+}
+
+template <class T>
+bool Node::extractScalars(T * & out, std::false_type) const
+{
+	for (auto & child : all())
+		if (!Converter<T>::fromNode(child, *out++))
+			return false;
+	
+	return true;
+}
+
+template <class T>
+bool Node::convert(T & out) const
+{
+	return convert(out, std::integral_constant<bool, (detail::CacheTag<T>::value > 0)>());
+}
+
+template <class T>
+bool Node::convert(T & out, std::false_type) const
+{
+	return Converter<T>::fromNode(*this, out);
+}
+
+template <class T>
+bool Node::convert(T & out, std::true_type) const
+{
+	const uint32_t tag = detail::CacheTag<T>::value;
+	
+	// Like a seqlock: the value is used only if no other thread stored anything while it was loaded.
+	uint32_t state = cache_state.load(std::memory_order_acquire);
+	if ((state & detail::cache_tag_mask) == tag)
+	{
+		uint64_t bits = cache.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (cache_state.load(std::memory_order_relaxed) == state)
+		{
+			memcpy(&out, &bits, sizeof(T));
+			return true;
+		}
+	}
+	
+	if (!Converter<T>::fromNode(*this, out))
+		return false;
+	
+	// If other thread is storing now, this value is just not cached.
+	uint32_t stored = (state & ~detail::cache_tag_mask) + detail::cache_tag_mask + 1;
+	if ((state & detail::cache_tag_mask) != detail::cache_busy
+	    && cache_state.compare_exchange_strong(state, stored | detail::cache_busy, std::memory_order_relaxed))
+	{
+		std::atomic_thread_fence(std::memory_order_release);
+		uint64_t bits = 0;
+		memcpy(&bits, &out, sizeof(T));
+		cache.store(bits, std::memory_order_relaxed);
+		cache_state.store(stored | tag, std::memory_order_release);
+	}
+	
+	return true;
+}
+
+
 template <class T>
 Node & Node::operator=(const T & value)
 {
@@ -1,7 +1,6 @@
 #ifndef	_PPK_NODEITERATORS_HPP
 #define _PPK_NODEITERATORS_HPP
 
-#include <map>
 #include <vector>
 
 
@@ -41,7 +40,7 @@ public:
 
 namespace detail
 {
-typedef std::multimap<std::string, Node*> block_type;
+typedef std::vector<Node*> block_type;  // Sorted by name, then chronologically
 typedef std::vector<Node*> block_index_type;
 
 
@@ -44,13 +44,13 @@ bool GroupIterator<T>::operator!=(const GroupIterator<T> & scnd) const
 template <class T>
 typename GroupIterator<T>::value_type & GroupIterator<T>::operator*() const
 {
-	return *iter->second;
+	return **iter;
 }
 
 template <class T>
 typename GroupIterator<T>::value_type *GroupIterator<T>::operator->() const
 {
-	return iter->second;
+	return *iter;
 }
 
 template <class T>
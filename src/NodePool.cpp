@@ -0,0 +1,57 @@
+#include "NodePool.hpp"
+
+#include <algorithm>
+
+#include "Node.hpp"
+
+using namespace ppk;
+using namespace ppk::detail;
+
+namespace
+{
+
+// Chunks grow from the first size to the last, so that small trees don't waste memory.
+const size_t first_chunk_size = 16;
+const size_t last_chunk_size = 1024;
+
+}
+
+NodePool::NodePool() :
+    used(0),
+    capacity(0)
+{
+}
+
+NodePool::~NodePool()
+{
+	for (auto & chunk : chunks)
+		::operator delete(chunk);
+}
+
+Node * NodePool::create(const InternedString * name, const InternedString * identifier)
+{
+	if (used == capacity)
+	{
+		size_t size = capacity ? std::min(2 * capacity, last_chunk_size) : first_chunk_size;
+		chunks.reserve(chunks.size() + 1);
+		chunks.push_back(::operator new(sizeof(Node) * size));
+		used = 0;
+		capacity = size;
+	}
+
+	Node * node = new (static_cast<Node *>(chunks.back()) + used) Node(name, identifier);
+	node->pooled = true;
+	used++;
+	return node;
+}
+
+void NodePool::adopt(const std::shared_ptr<NodePool> & other)
+{
+	std::lock_guard<std::mutex> guard(mutex);
+	adopted.push_back(other);
+}
+
+std::unique_lock<std::mutex> NodePool::lock()
+{
+	return std::unique_lock<std::mutex>(mutex);
+}
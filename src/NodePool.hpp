@@ -0,0 +1,52 @@
+#ifndef _PPK_NODEPOOL_HPP
+#define _PPK_NODEPOOL_HPP
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace ppk
+{
+
+class Node;
+
+namespace detail
+{
+
+struct InternedString;
+
+// Memory for nodes of a tree, allocated in big chunks instead of one by one.
+// Destroyed nodes don't give their memory back, it is all freed with the pool.
+// So the pool must outlive its nodes.
+class NodePool
+{
+public:
+	NodePool();
+	NodePool(const NodePool &) = delete;
+	const NodePool & operator=(const NodePool &) = delete;
+	~NodePool();
+
+	// Like new Node(name, identifier). Not thread-safe, unless the pool is locked.
+	Node * create(const InternedString * name, const InternedString * identifier);
+
+	// Keeps the other pool alive as long as this one. Thread-safe.
+	void adopt(const std::shared_ptr<NodePool> & other);
+
+	// Must be held by all threads using create() at the same time
+	std::unique_lock<std::mutex> lock();
+
+private:
+	std::vector<void *> chunks;
+	size_t used;  // Number of nodes in the last chunk
+	size_t capacity;  // Size of the last chunk
+
+	std::vector<std::shared_ptr<NodePool>> adopted;
+	std::mutex mutex;
+};
+
+}
+}
+
+
+#endif //_PPK_NODEPOOL_HPP
@@ -0,0 +1,476 @@
+#include "NodeView.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+#include "utility.hpp"
+#include "FS.hpp"
+#include "MappedFile.hpp"
+#include "TreeLayout.hpp"
+#include "StandardConverters.hpp"
+#include "TextWriter.hpp"
+
+using namespace ppk;
+using namespace ppk::detail;
+
+namespace
+{
+
+// Writes the layout to the file as text, like FS::write(). Sets error message if it fails.
+bool writeText(const TreeLayout & layout, bool compact, const std::string & path, std::string & errorMsg)
+{
+	errorMsg.clear();
+
+	FILE * file = fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		errorMsg = "Error in \"" + path + "\": can't open";
+		return false;
+	}
+
+	TextWriter writer(file);
+	writer.setCompact(compact);
+	bool result;
+	try {
+		result = writer.write(layout);
+	}
+	catch (const std::runtime_error & e)
+	{
+		fclose(file);
+		errorMsg = "Error in \"" + path + "\": " + e.what();
+		return false;
+	}
+
+	if (fclose(file) != 0 || !result)
+	{
+		errorMsg = "Error in \"" + path + "\": can't write";
+		return false;
+	}
+
+	return true;
+}
+
+void writeTextString(const TreeLayout & layout, bool compact, std::string & output)
+{
+	TextWriter writer(output);
+	writer.setCompact(compact);
+	writer.write(layout);
+}
+
+}
+
+NodeView::NodeView(const TreeLayout * layout, uint32_t index) :
+    layout(layout),
+    index(index)
+{
+}
+
+Node::Type NodeView::getType() const
+{
+	return static_cast<Node::Type>(layout->getType(index));
+}
+
+bool NodeView::hasName() const
+{
+	return layout->names[index] != 0;  // The empty string is always the first one
+}
+
+bool NodeView::hasIdentifier() const
+{
+	return layout->identifiers[index] != 0;
+}
+
+bool NodeView::isRoot() const
+{
+	return index == 0;
+}
+
+unsigned NodeView::size() const
+{
+	return layout->child_counts[index];
+}
+
+unsigned NodeView::count(const StringRef & name) const
+{
+	uint32_t first, last;
+	equalRange(name, first, last);
+	return last - first;
+}
+
+bool NodeView::hasKey(const StringRef & name) const
+{
+	uint32_t first, last;
+	equalRange(name, first, last);
+	return first != last;
+}
+
+bool NodeView::hasDimensions(const std::list<size_t> & dimensions) const
+{
+	return hasDimensions(dimensions.cbegin(), dimensions.cend());
+}
+
+bool NodeView::hasDimensions(std::list<size_t>::const_iterator it, std::list<size_t>::const_iterator end) const
+{
+	if (size() != *it)
+		return false;
+
+	if (++it == end)
+		return true;
+
+	for (auto & child : all())
+		if (!child.hasDimensions(it, end))
+			return false;
+
+	return true;
+}
+
+StringRef NodeView::getName() const
+{
+	return layout->getString(layout->names[index]);
+}
+
+StringRef NodeView::getIdentifier() const
+{
+	return layout->getString(layout->identifiers[index]);
+}
+
+NodeView NodeView::getParent() const
+{
+	return NodeView(layout, layout->getParent(index));
+}
+
+StringRef NodeView::getScalar() const
+{
+	return layout->getString(layout->values[index]);
+}
+
+NodeView NodeView::operator[](const StringRef & name) const
+{
+	uint32_t first, last;
+	equalRange(name, first, last);
+
+	if (first == last)
+		throw std::out_of_range("There is no such key as " + name.str() + " in node " + getName().str() + (hasIdentifier() ? " " + getIdentifier().str() : "") + "!");
+
+	return NodeView(layout, layout->getSorted(index, last - 1));
+}
+
+NodeView NodeView::operator[](unsigned index) const
+{
+	if (index < size())
+		return NodeView(layout, layout->getFirstChild(this->index) + index);
+
+	throw std::out_of_range("There are only " + detail::to_string(size()) + " subnodes in node " +
+	                        getName().str() + (hasIdentifier() ? " " + getIdentifier().str() : "") + "! (Requested index: " + detail::to_string(index) + ")"
+	                        );
+}
+
+std::string NodeView::operator()(const StringRef & name, const char * default_val) const
+{
+	if (hasKey(name))
+		return (*this)[name];
+
+	return std::string(default_val);
+}
+
+IteratorReturner<ViewIterator> NodeView::all() const
+{
+	int64_t first = layout->getFirstChild(index);
+	return IteratorReturner<ViewIterator>(ViewIterator(layout, index, first, false, false),
+	                                      ViewIterator(layout, index, first + size(), false, false));
+}
+
+IteratorReturner<ViewIterator> NodeView::rall() const
+{
+	int64_t first = layout->getFirstChild(index);
+	return IteratorReturner<ViewIterator>(ViewIterator(layout, index, first + size() - 1, false, true),
+	                                      ViewIterator(layout, index, first - 1, false, true));
+}
+
+IteratorReturner<ViewIterator> NodeView::only(const StringRef & name) const
+{
+	uint32_t first, last;
+	equalRange(name, first, last);
+	return IteratorReturner<ViewIterator>(ViewIterator(layout, index, first, true, false),
+	                                      ViewIterator(layout, index, last, true, false));
+}
+
+IteratorReturner<ViewIterator> NodeView::ronly(const StringRef & name) const
+{
+	uint32_t first, last;
+	equalRange(name, first, last);
+	return IteratorReturner<ViewIterator>(ViewIterator(layout, index, int64_t(last) - 1, true, true),
+	                                      ViewIterator(layout, index, int64_t(first) - 1, true, true));
+}
+
+IteratorReturner<ViewIterator> NodeView::sorted() const
+{
+	int64_t first = layout->getFirstChild(index);
+	return IteratorReturner<ViewIterator>(ViewIterator(layout, index, first, true, false),
+	                                      ViewIterator(layout, index, first + size(), true, false));
+}
+
+IteratorReturner<ViewIterator> NodeView::rsorted() const
+{
+	int64_t first = layout->getFirstChild(index);
+	return IteratorReturner<ViewIterator>(ViewIterator(layout, index, first + size() - 1, true, true),
+	                                      ViewIterator(layout, index, first - 1, true, true));
+}
+
+void NodeView::print(int d) const
+{
+	for (int i = 0; i < d; i++)
+		printf("\t");
+	StringRef name = getName(), identifier = getIdentifier(), scalar = getScalar();
+	if (hasIdentifier())
+		printf("%.*s \"%.*s\"= %.*s\n", int(name.size()), name.data(), int(identifier.size()), identifier.data(),
+		       int(scalar.size()), scalar.data());
+	else
+		printf("%.*s = %.*s\n", int(name.size()), name.data(), int(scalar.size()), scalar.data());
+
+	for (auto & it : all())
+	{
+		it.print(d + 1);
+	}
+}
+
+void NodeView::equalRange(const StringRef & name, uint32_t & first, uint32_t & last) const
+{
+	first = last = layout->getFirstChild(index);
+
+	uint32_t id = layout->findString(name);
+	if (id == layout->string_count)
+		return;
+
+	const uint32_t * begin = layout->sorted + first;
+	const uint32_t * end = begin + size();
+	const TreeLayout * layout = this->layout;
+	auto name_of = [layout](uint32_t child) { return layout->names[layout->checkNode(child)]; };
+
+	const uint32_t * lower = std::lower_bound(begin, end, id, [&name_of](uint32_t child, uint32_t id) { return name_of(child) < id; });
+	const uint32_t * upper = std::upper_bound(lower, end, id, [&name_of](uint32_t id, uint32_t child) { return id < name_of(child); });
+
+	first += lower - begin;
+	last += upper - begin;
+}
+
+
+
+MappedTree::MappedTree() :
+    layout(new TreeLayout(emptyLayout())),
+    compact(false)
+{
+}
+
+MappedTree::~MappedTree()
+{
+}
+
+bool MappedTree::open(const std::string & path, bool verify)
+{
+	errorMsg.clear();
+	*layout = emptyLayout();
+	file.reset();
+
+	try {
+		file.reset(new MappedFile(path, false));
+	}
+	catch (const std::runtime_error & e)
+	{
+		errorMsg = "Error in \"" + path + "\": " + e.what();
+		return false;
+	}
+
+	if (!openImage(file->data(), file->size(), *layout, verify))
+	{
+		*layout = emptyLayout();
+		file.reset();
+		errorMsg = "Error in \"" + path + "\": it isn't a valid image";
+		return false;
+	}
+
+	return true;
+}
+
+const std::string & MappedTree::getError() const
+{
+	return errorMsg;
+}
+
+NodeView MappedTree::getRoot() const
+{
+	return NodeView(layout.get(), 0);
+}
+
+void MappedTree::setCompact(bool compact)
+{
+	this->compact = compact;
+}
+
+bool MappedTree::write(const std::string & path)
+{
+	return writeText(*layout, compact, path, errorMsg);
+}
+
+void MappedTree::writeString(std::string & output) const
+{
+	writeTextString(*layout, compact, output);
+}
+
+
+
+FlatTree::FlatTree() :
+    arrays(new TreeArrays),
+    layout(new TreeLayout(arrays->getLayout())),
+    compact(false)
+{
+}
+
+FlatTree::FlatTree(const Node & root) :
+    FlatTree()
+{
+	arrays->build(root);
+	*layout = arrays->getLayout();
+}
+
+FlatTree::~FlatTree()
+{
+}
+
+template <class Parse>
+bool FlatTree::readWith(Parse parse)
+{
+	errorMsg.clear();
+
+	FS fs;
+	TreeArrays::Builder builder;
+	bool result;
+	try {
+		result = parse(fs, builder);
+		builder.finish(*arrays);
+	}
+	catch (const std::length_error & e)
+	{
+		*arrays = TreeArrays();
+		*layout = arrays->getLayout();
+		errorMsg = e.what();
+		return false;
+	}
+
+	*layout = arrays->getLayout();
+	if (!result)
+		errorMsg = fs.getError();
+	return result;
+}
+
+bool FlatTree::read(const std::string & path)
+{
+	return readWith([&](FS & fs, Handler & handler) { return fs.parse(path, handler); });
+}
+
+bool FlatTree::readBuffer(const char * data, size_t size, const std::string & name)
+{
+	return readWith([&](FS & fs, Handler & handler) { return fs.parseBuffer(data, size, handler, name); });
+}
+
+const std::string & FlatTree::getError() const
+{
+	return errorMsg;
+}
+
+bool FlatTree::writeImage(const std::string & path)
+{
+	errorMsg.clear();
+
+	FILE * file = fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		errorMsg = "Error in \"" + path + "\": can't open";
+		return false;
+	}
+
+	bool result = arrays->write(file);
+
+	if (fclose(file) != 0 || !result)
+	{
+		errorMsg = "Error in \"" + path + "\": can't write";
+		return false;
+	}
+
+	return true;
+}
+
+NodeView FlatTree::getRoot() const
+{
+	return NodeView(layout.get(), 0);
+}
+
+void FlatTree::setCompact(bool compact)
+{
+	this->compact = compact;
+}
+
+bool FlatTree::write(const std::string & path)
+{
+	return writeText(*layout, compact, path, errorMsg);
+}
+
+void FlatTree::writeString(std::string & output) const
+{
+	writeTextString(*layout, compact, output);
+}
+
+
+
+ViewIterator::ViewIterator(const TreeLayout * layout, uint32_t parent, int64_t position, bool in_sorted, bool reversed) :
+    layout(layout),
+    parent(parent),
+    position(position),
+    in_sorted(in_sorted),
+    reversed(reversed),
+    current(layout, 0)
+{
+}
+
+bool ViewIterator::operator!=(const ViewIterator & scnd) const
+{
+	return position != scnd.position;
+}
+
+const NodeView & ViewIterator::operator*() const
+{
+	current = NodeView(layout, in_sorted ? layout->getSorted(parent, position) : position);
+	return current;
+}
+
+const NodeView * ViewIterator::operator->() const
+{
+	return &**this;
+}
+
+ViewIterator & ViewIterator::operator++()
+{
+	position += reversed ? -1 : 1;
+	return *this;
+}
+
+ViewIterator ViewIterator::operator++(int)
+{
+	ViewIterator tmp(*this);
+	++*this;
+	return tmp;
+}
+
+ViewIterator & ViewIterator::operator--()
+{
+	position -= reversed ? -1 : 1;
+	return *this;
+}
+
+ViewIterator ViewIterator::operator--(int)
+{
+	ViewIterator tmp(*this);
+	--*this;
+	return tmp;
+}
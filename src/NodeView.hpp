@@ -0,0 +1,389 @@
+#ifndef _PPK_NODEVIEW_HPP
+#define _PPK_NODEVIEW_HPP
+
+#include <cstdint>
+#include <memory>
+
+#include "Node.hpp"
+#include "StringRef.hpp"
+
+namespace ppk
+{
+
+namespace detail
+{
+struct TreeLayout;
+class TreeArrays;
+class MappedFile;
+class ViewIterator;
+}
+
+
+/**
+ * @brief The NodeView class is a read-only view of node of a MappedTree.
+ *
+ * It has the same getters as Node, but it is only a handle: it is small, it is
+ * passed by value and it is valid as long as its tree exists. Strings are
+ * returned as StringRef%s to the mapped file.
+ *
+ * Indices read from an image are checked when they are used, so if it is corrupted,
+ * the getters throw std::runtime_error, unless it was verified by MappedTree::open().
+ */
+class NodeView
+{
+public:
+	///@cond PRIVATE
+	NodeView(const detail::TreeLayout * layout, uint32_t index);
+	///@endcond
+
+
+	// -------------- ABOUT -------------- //
+	/// Returns type of the node
+	Node::Type getType() const;
+
+	/// Checks if the node is named
+	bool hasName() const;
+
+	/// Checks if the node has identifier
+	bool hasIdentifier() const;
+
+	/// Checks if the node is root of its tree
+	bool isRoot() const;
+
+
+	/// Returns number of its children.
+	unsigned size() const;
+
+	/// Returns number of its children of given name.
+	unsigned count(const StringRef & name) const;
+
+	/// Checks if it has child of given name.
+	bool hasKey(const StringRef & name) const;
+
+	/// @copydoc Node::hasDimensions()
+	bool hasDimensions(const std::list<size_t> & dimensions) const;
+
+
+	// ------------- GETTERS ------------- //
+	/// Returns its name.
+	StringRef getName() const;
+
+	/// Returns its identifier.
+	StringRef getIdentifier() const;
+
+	/// Returns its parent, or itself if it is the root.
+	NodeView getParent() const;
+
+	/**
+	 * @brief Returns contained scalar.
+	 * @return "" if it is not Scalar.
+	 */
+	StringRef getScalar() const;
+
+
+	/**
+	 * @brief Checks if scalar is convertible to given type.
+	 *
+	 * Types which Converter has `fromString(StringRef, Type &)` are converted directly,
+	 * other ones through a temporary Node. Only scalars can be converted.
+	 */
+	template <class T> bool is() const;
+
+	/**
+	 * @brief Converts scalar to given type.
+	 * @throws std::invalid_argument when conversion failed.
+	 * @see is()
+	 */
+	template <class T> T as() const;
+
+	/**
+	 * @brief Casts scalar to given type.
+	 * @throws std::invalid_argument when conversion failed.
+	 */
+	template <class T> operator T() const;
+
+
+	/**
+	 * @brief Returns the last child of given name
+	 * @throws std::out_of_range if there is no such child
+	 */
+	NodeView operator[](const StringRef & name) const;
+
+	/**
+	 * @brief Returns index-th element in chronological order.
+	 * @throws std::out_of_range when `index >= size()`
+	 */
+	NodeView operator[](unsigned index) const;
+
+	/**
+	 * @brief Gets value from child or default one.
+	 * @see Node::operator()(const std::string &, const T &) const
+	 */
+	template <class T> T operator()(const StringRef & name, const T & default_val) const;
+
+	///@cond PRIVATE
+	std::string operator()(const StringRef & name, const char * default_val) const;
+	///@endcond
+
+
+	// ------------ IERATORS ------------ //
+	/**
+	 * @name Iterators
+	 *
+	 * The same as in Node. Iterators keep the current NodeView, so it's
+	 * reference is valid until the iterator is moved.
+	 */
+	///@{
+
+	/// All children in chronological order.
+	IteratorReturner<detail::ViewIterator> all() const;
+
+	/// All children in reversed chronological order.
+	IteratorReturner<detail::ViewIterator> rall() const;
+
+	/// All children of given name in chronological order.
+	IteratorReturner<detail::ViewIterator> only(const StringRef & name) const;
+
+	/// All children of given name in reversed chronological order.
+	IteratorReturner<detail::ViewIterator> ronly(const StringRef & name) const;
+
+	/// All children sorted by name (identifier doesn't matter), then in chronological order
+	IteratorReturner<detail::ViewIterator> sorted() const;
+
+	/// All children sorted by name (descending, identifier doesn't matter), then in reversed chronological order
+	IteratorReturner<detail::ViewIterator> rsorted() const;
+	///@}
+
+
+	// -------------- DEBUG -------------- //
+	/// @copydoc Node::print()
+	void print(int d = 0) const;
+
+private:
+	const detail::TreeLayout * layout;
+	uint32_t index;
+
+	// Range of sorted children of given name
+	void equalRange(const StringRef & name, uint32_t & first, uint32_t & last) const;
+
+	bool hasDimensions(std::list<size_t>::const_iterator it,         // helper for hasDimensions()
+	                   std::list<size_t>::const_iterator end) const;
+};
+
+
+
+/**
+ * @brief The MappedTree class gives read-only access to tree saved by FS::writeImage().
+ *
+ * The file is mapped into memory and used as it is, without parsing or copying it.
+ * That makes opening almost instant and lets many processes share one copy of
+ * the file in memory. Image files are not portable between machines of different
+ * endianness.
+ */
+class MappedTree
+{
+public:
+	/// Constructs tree with only empty root.
+	MappedTree();
+
+	/// Noncopyable.
+	MappedTree(const MappedTree &) = delete;
+
+	/// Nonassignable
+	MappedTree & operator=(const MappedTree &) = delete;
+
+	/// Unmaps the file. All NodeView%s become invalid.
+	~MappedTree();
+
+	/**
+	 * @brief Maps file written by FS::writeImage().
+	 *
+	 * Previously opened file is closed. Only its header and bounds of its arrays are checked,
+	 * indices in them are checked when they are used. The file must not be modified while it is mapped.
+	 *
+	 * @param verify -- if true, all indices are checked at once, reading the whole file, and a corrupted
+	 *                  image is an error here instead of an exception thrown later by NodeView%s
+	 * @return true if no errors happened @see getError()
+	 */
+	bool open(const std::string & path, bool verify = false);
+
+	/// Returns the last error message.
+	const std::string & getError() const;
+
+	/// Returns the root node.
+	NodeView getRoot() const;
+
+	/**
+	 * @brief Sets if text written by write() is compact, like FS::setCompact() makes it.
+	 * @param compact -- the default is false
+	 */
+	void setCompact(bool compact);
+
+	/**
+	 * @brief Writes the tree to given file as text, like FS::write().
+	 *
+	 * Nodes are written straight from the arrays, without making Node%s.
+	 * @return true if no errors happened @see getError()
+	 */
+	bool write(const std::string & path);
+
+	/**
+	 * @brief Appends the tree as text to given string. @see write()
+	 * @throws std::runtime_error if the image is corrupted
+	 */
+	void writeString(std::string & output) const;
+
+private:
+	std::unique_ptr<detail::MappedFile> file;
+	std::unique_ptr<detail::TreeLayout> layout;
+	bool compact;
+	std::string errorMsg;
+};
+
+
+
+/**
+ * @brief The FlatTree class is a read-only tree kept in memory in parallel arrays.
+ *
+ * Each property of nodes (type, name, parent, children, scalar...) is stored in its own array
+ * and nodes are addressed by 32-bit indices, children of every node next to each other.
+ * So it takes much less memory than Node%s and traversing it reads memory sequentially.
+ * Nodes are accessed through NodeView%s, like in MappedTree.
+ */
+class FlatTree
+{
+public:
+	/// Constructs tree with only empty root.
+	FlatTree();
+
+	/**
+	 * @brief Copies tree of the node, which becomes the root.
+	 * @throws std::length_error if it has more nodes than 32-bit indices can address
+	 */
+	explicit FlatTree(const Node & root);
+
+	/// Noncopyable.
+	FlatTree(const FlatTree &) = delete;
+
+	/// Nonassignable
+	FlatTree & operator=(const FlatTree &) = delete;
+
+	/// Standard destructor. All NodeView%s become invalid.
+	~FlatTree();
+
+	/**
+	 * @brief Reads data from given path straight into the arrays, without making Node%s.
+	 *
+	 * Path can lead to both file and directory, like in FS::read(). Previous contents are
+	 * replaced, so all NodeView%s become invalid. After an error the tree has nodes read
+	 * before it, also like in FS::read().
+	 *
+	 * @return true if no errors happened @see getError()
+	 */
+	bool read(const std::string & path);
+
+	/**
+	 * @brief Reads data from memory.
+	 * @see read(), FS::readBuffer()
+	 */
+	bool readBuffer(const char * data, size_t size, const std::string & name = "<buffer>");
+
+	/// Returns the last error message.
+	const std::string & getError() const;
+
+	/// Writes the tree to given file as an image, which can be used by MappedTree.
+	bool writeImage(const std::string & path);
+
+	/**
+	 * @brief Sets if text written by write() is compact, like FS::setCompact() makes it.
+	 * @param compact -- the default is false
+	 */
+	void setCompact(bool compact);
+
+	/**
+	 * @brief Writes the tree to given file as text, like FS::write().
+	 *
+	 * Nodes are written straight from the arrays, without making Node%s.
+	 * @return true if no errors happened @see getError()
+	 */
+	bool write(const std::string & path);
+
+	/// Appends the tree as text to given string. @see write()
+	void writeString(std::string & output) const;
+
+	/// Returns the root node.
+	NodeView getRoot() const;
+
+private:
+	std::unique_ptr<detail::TreeArrays> arrays;
+	std::unique_ptr<detail::TreeLayout> layout;
+	bool compact;
+	std::string errorMsg;
+
+	// Reads data with given function of FS, which parses it into the handler
+	template <class Parse> bool readWith(Parse parse);
+};
+
+
+
+namespace detail
+{
+
+// Iterator over children of NodeView. It keeps the view it points to, so that it can return reference.
+class ViewIterator
+{
+public:
+	// Iterates over children of the parent with given positions in chronological or sorted order
+	ViewIterator(const TreeLayout * layout, uint32_t parent, int64_t position, bool in_sorted, bool reversed);
+
+	bool operator!=(const ViewIterator & scnd) const;
+
+	const NodeView & operator*() const;
+	const NodeView * operator->() const;
+
+	ViewIterator & operator++();
+	ViewIterator operator++(int);
+	ViewIterator & operator--();
+	ViewIterator operator--(int);
+
+private:
+	const TreeLayout * layout;
+	uint32_t parent;
+	int64_t position;
+	bool in_sorted;
+	bool reversed;
+	mutable NodeView current;
+};
+
+
+// Converts with Converter<T>::fromString if it exists, otherwise through a temporary Node.
+template <class T>
+class HasFromString
+{
+	template <class C> static char test(decltype(&C::fromString));
+	template <class C> static long test(...);
+
+public:
+	static const bool value = sizeof(test<Converter<T>>(0)) == 1;
+};
+
+template <class T>
+bool convertScalar(const StringRef & str, T & out, std::true_type)
+{
+	return Converter<T>::fromString(str, out);
+}
+
+template <class T>
+bool convertScalar(const StringRef & str, T & out, std::false_type)
+{
+	Node node;
+	node.setScalar(str);
+	return Converter<T>::fromNode(node, out);
+}
+
+}
+}
+
+#include "NodeView.tpp"
+
+#endif //_PPK_NODEVIEW_HPP
@@ -0,0 +1,46 @@
+#ifndef NODEVIEW_TPP
+#define NODEVIEW_TPP
+
+#include <type_traits>
+
+
+namespace ppk
+{
+
+
+template <class T>
+bool NodeView::is() const
+{
+	T t;
+	return getType() == Node::Type::Scalar
+	    && detail::convertScalar(getScalar(), t, std::integral_constant<bool, detail::HasFromString<T>::value>());
+}
+
+template <class T>
+T NodeView::as() const
+{
+	T t;
+	if (getType() != Node::Type::Scalar
+	    || !detail::convertScalar(getScalar(), t, std::integral_constant<bool, detail::HasFromString<T>::value>()))
+		throw std::invalid_argument(getName().str() + (hasIdentifier() ? " " + getIdentifier().str() : "") + " is not " + Converter<T>::type_name + "!");
+	return t;
+}
+
+
+template <class T>
+NodeView::operator T() const
+{
+	return as<T>();
+}
+
+
+template <class T>
+T NodeView::operator()(const StringRef & name, const T & default_val) const
+{
+	if (hasKey(name))
+		return (*this)[name];
+	return default_val;
+}
+}
+
+#endif // NODEVIEW_TPP
@@ -0,0 +1,113 @@
+#include "PackedList.hpp"
+
+using namespace ppk;
+using namespace ppk::detail;
+
+namespace
+{
+
+const unsigned max_decimals = 22;
+const int64_t max_real_mantissa = int64_t(1) << 53;  // Bigger mantissas of reals are not exact as doubles
+
+}
+
+bool PackedList::push(const StringRef & text)
+{
+	const char * p = text.begin(), * end = text.end();
+
+	bool negative = p != end && *p == '-';
+	if (negative)
+		++p;
+
+	// Integer part. 19 digits always fit.
+	const char * digits = p;
+	uint64_t mantissa = 0;
+	for (; p != end && *p >= '0' && *p <= '9'; ++p)
+	{
+		if (p - digits == 19)
+			return false;
+		mantissa = mantissa * 10 + (*p - '0');
+	}
+
+	if (p == digits || (p - digits > 1 && *digits == '0'))
+		return false;
+
+	unsigned exponent = 0;
+	if (p != end)
+	{
+		if (*p != '.')
+			return false;
+
+		const char * fraction = ++p;
+		for (; p != end && *p >= '0' && *p <= '9'; ++p)
+		{
+			if (mantissa >= static_cast<uint64_t>(max_real_mantissa))
+				return false;
+			mantissa = mantissa * 10 + (*p - '0');
+		}
+
+		exponent = p - fraction;
+		if (p != end || exponent == 0 || exponent > max_decimals || mantissa >= static_cast<uint64_t>(max_real_mantissa))
+			return false;
+	}
+
+	// -0 and -0.0 would lose their sign
+	if (negative && mantissa == 0)
+		return false;
+	if (mantissa > static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + negative)
+		return false;
+
+	// Integers in lists with reals must be exact as doubles too
+	if (exponent > 0 && decimals.empty())
+	{
+		for (auto & integer : mantissas)
+			if (integer > max_real_mantissa || integer < -max_real_mantissa)
+				return false;
+		decimals.resize(mantissas.size(), 0);
+	}
+	if (exponent == 0 && !decimals.empty() && mantissa > static_cast<uint64_t>(max_real_mantissa))
+		return false;
+
+	mantissas.push_back(negative ? static_cast<int64_t>(0 - mantissa) : static_cast<int64_t>(mantissa));
+	if (exponent > 0 || !decimals.empty())
+		decimals.push_back(exponent);
+	return true;
+}
+
+size_t PackedList::format(size_t index, char * buffer) const
+{
+	int64_t mantissa = mantissas[index];
+	unsigned exponent = getDecimals(index);
+	uint64_t magnitude = mantissa < 0 ? 0 - static_cast<uint64_t>(mantissa) : mantissa;
+
+	// Digits from the last one, with zeros up to the one before the point
+	char digits[text_size];
+	size_t count = 0;
+	while (magnitude > 0 || count <= exponent)
+	{
+		digits[count++] = '0' + magnitude % 10;
+		magnitude /= 10;
+	}
+
+	size_t length = 0;
+	if (mantissa < 0)
+		buffer[length++] = '-';
+
+	while (count > 0)
+	{
+		if (count == exponent)
+			buffer[length++] = '.';
+		buffer[length++] = digits[--count];
+	}
+
+	return length;
+}
+
+double PackedList::power(unsigned exponent)
+{
+	static const double powers[max_decimals + 1] = {
+	    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+	};
+	return powers[exponent];
+}
@@ -0,0 +1,116 @@
+#ifndef _PPK_PACKEDLIST_HPP
+#define _PPK_PACKEDLIST_HPP
+
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "StringRef.hpp"
+
+
+namespace ppk
+{
+
+template <class Type> class Converter;
+
+///@cond PRIVATE
+namespace detail
+{
+
+// Numbers of a list, kept in arrays instead of child nodes until the nodes are needed.
+// Only numbers whose text can be made again exactly are kept: decimal integers, and reals
+// like 12.50 which have at most 15 significant digits. Leading zeros, '+' and -0 are not allowed.
+class PackedList
+{
+public:
+	// Enough for text of any kept number
+	static const size_t text_size = 48;
+
+	// Appends number written in the text. Returns false if it can't be kept, then nothing changes.
+	bool push(const StringRef & text);
+
+	size_t size() const
+	{
+		return mantissas.size();
+	}
+
+	// Writes text of the number at index, as it was read. Returns its length.
+	size_t format(size_t index, char * buffer) const;
+
+	// Converts the number at index like Converter<T>::fromString() converts its text.
+	template <class T> bool get(size_t index, T & out) const;
+
+private:
+	std::vector<int64_t> mantissas;  // Numbers without the decimal point
+	std::vector<uint8_t> decimals;  // Numbers of digits after the point, empty while all numbers are integers
+
+	uint8_t getDecimals(size_t index) const
+	{
+		return decimals.empty() ? 0 : decimals[index];
+	}
+
+	static double power(unsigned exponent);  // exactly 10^exponent, for exponent <= 22
+
+	// Conversions without the text, where they give the same results. Return false if they can't be used.
+	template <class T> static bool convert(int64_t mantissa, unsigned exponent, T & out, std::true_type integer);
+	template <class T> static bool convert(int64_t mantissa, unsigned exponent, T & out, std::false_type integer);
+};
+
+
+template <class T>
+bool PackedList::get(size_t index, T & out) const
+{
+	// Integer types except bool and characters, which are converted differently
+	typedef std::integral_constant<bool, std::is_integral<T>::value && !std::is_same<T, bool>::value && (sizeof(T) > 1)> integer;
+	
+	if (convert(mantissas[index], getDecimals(index), out, integer()))
+		return true;
+	
+	char buffer[text_size];
+	return Converter<T>::fromString(StringRef(buffer, format(index, buffer)), out);
+}
+
+template <class T>
+bool PackedList::convert(int64_t mantissa, unsigned exponent, T & out, std::true_type)
+{
+	if (exponent > 0)
+		return false;
+	
+	// Values out of range are left to the text conversion, as unsigned ones can wrap
+	if (mantissa >= 0 ? static_cast<uint64_t>(mantissa) > static_cast<uint64_t>(std::numeric_limits<T>::max())
+	                  : mantissa < static_cast<int64_t>(std::numeric_limits<T>::min()))
+		return false;
+	
+	out = static_cast<T>(mantissa);
+	return true;
+}
+
+template <class T>
+bool PackedList::convert(int64_t mantissa, unsigned exponent, T & out, std::false_type)
+{
+	if (!std::is_floating_point<T>::value)
+		return false;
+	
+	if (exponent == 0)
+	{
+		out = static_cast<T>(mantissa);
+		return true;
+	}
+	
+	// Both are exact, so the quotient is rounded only once. Floats would be rounded twice.
+	if (std::is_same<T, double>::value)
+	{
+		out = static_cast<T>(static_cast<double>(mantissa) / power(exponent));
+		return true;
+	}
+	
+	return false;
+}
+
+}
+///@endcond
+}
+
+
+#endif //_PPK_PACKEDLIST_HPP
@@ -0,0 +1,302 @@
+#include "Scanner.hpp"
+
+using namespace ppk;
+using namespace ppk::detail;
+
+namespace
+{
+
+// Checks if quote at position starts a quoted string. It doesn't if it is a part of
+// a not quoted scalar, e.g. it's. quoted_end is the end of previous quoted string.
+bool isQuoteStart(const char * position, const char * begin, const char * quoted_end)
+{
+	return position == begin || position == quoted_end || !isScalarChar(position[-1]);
+}
+
+// Returns position after the closing quote, or end
+const char * skipQuoted(const char * position, const char * end)
+{
+	char quote = *position++;
+	while ((position = findQuoteOrEscape(position, end, quote)) != end)
+	{
+		if (*position == quote)
+			return position + 1;
+		
+		if (end - position < 2)
+			return end;
+		position += 2;
+	}
+	return end;
+}
+
+}
+
+// 1 - scalar_char, 2 - space_char; rows of 16 characters
+const unsigned char detail::char_classes[256] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 0, 0,  // 0x00
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0x10
+	2, 1, 1, 0, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 1, 1,  // 0x20
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1, 1,  // 0x30
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  // 0x40
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1, 1,  // 0x50
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,  // 0x60
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1, 0,  // 0x70
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0x80
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0x90
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0xA0
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0xB0
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0xC0
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0xD0
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0xE0
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  // 0xF0
+};
+
+
+const char * detail::skipBrackets(const char * begin, const char * end)
+{
+	const char * position = begin, * quoted_end = NULL;
+	size_t depth = 0;
+	
+	while ((position = findSpecial(position, end)) != end)
+	{
+		switch (*position)
+		{
+		case '{':
+		case '[':
+			++depth;
+			++position;
+			break;
+		case '}':
+		case ']':
+			++position;
+			if (--depth == 0)
+				return position;
+			break;
+		case '#':
+			position = findNewline(position, end);
+			break;
+		default:
+			if (isQuoteStart(position, begin, quoted_end))
+				quoted_end = position = skipQuoted(position, end);
+			else
+				++position;
+		}
+	}
+	
+	return NULL;
+}
+
+std::vector<const char *> detail::findSplitPoints(const char * begin, const char * end, size_t min_size)
+{
+	std::vector<const char *> points;
+	const char * position = begin, * quoted_end = NULL, * last = begin;
+	
+	while ((position = findSpecial(position, end)) != end)
+	{
+		switch (*position)
+		{
+		case '{':
+		case '[':
+		{
+			position = skipBrackets(position, end);
+			if (!position)
+				return points;
+			
+			// Node ends after the brackets, unless it is a list like a = {}, {}
+			if (static_cast<size_t>(position - last) >= min_size && static_cast<size_t>(end - position) >= min_size)
+			{
+				const char * next = skipSpacesAndComments(position, end);
+				if (next != end && *next != ',')
+				{
+					points.push_back(position);
+					last = position;
+				}
+			}
+			break;
+		}
+		case '}':
+		case ']':
+			++position;
+			break;
+		case '#':
+			position = findNewline(position, end);
+			break;
+		default:
+			if (isQuoteStart(position, begin, quoted_end))
+				quoted_end = position = skipQuoted(position, end);
+			else
+				++position;
+		}
+	}
+	
+	return points;
+}
+
+
+FeedScanner::FeedScanner() :
+    mode(Mode::Space),
+    expect(Expect::Name),
+    quote(0),
+    quote_can_start(true),
+    depth(0),
+    offset(0),
+    boundary(0)
+{
+}
+
+uint64_t FeedScanner::scan(const char * begin, const char * end)
+{
+	const char * position = begin, * quoted_end = NULL;
+	
+	while (position != end && expect != Expect::Error)
+	{
+		switch (mode)
+		{
+		case Mode::Comment:
+			position = findNewline(position, end);
+			if (position != end)
+				mode = Mode::Space;
+			break;
+		case Mode::Unquoted:
+			position = findScalarEnd(position, end);
+			if (position != end)
+			{
+				mode = Mode::Space;
+				endScalar();
+			}
+			break;
+		case Mode::Quoted:
+			position = findQuoteOrEscape(position, end, quote);
+			if (position == end)
+				break;
+			
+			if (*position == quote)
+			{
+				mode = Mode::Space;
+				quoted_end = position + 1;
+				if (depth == 0)
+					endScalar();
+			}
+			else
+				mode = Mode::Escape;
+			++position;
+			break;
+		case Mode::Escape:
+			mode = Mode::Quoted;
+			++position;
+			break;
+		case Mode::Space:
+			if (depth == 0)
+			{
+				scanTopLevel(begin, position);
+				break;
+			}
+			
+			// Inside brackets only brackets, strings and comments matter, like in skipBrackets()
+			position = findSpecial(position, end);
+			if (position == end)
+				break;
+			
+			switch (*position)
+			{
+			case '{':
+			case '[':
+				++depth;
+				break;
+			case '}':
+			case ']':
+				if (--depth == 0)
+					expect = Expect::AfterValue;
+				break;
+			case '#':
+				mode = Mode::Comment;
+				break;
+			default:
+				if (position == begin ? quote_can_start : isQuoteStart(position, begin, quoted_end))
+				{
+					mode = Mode::Quoted;
+					quote = *position;
+				}
+			}
+			++position;
+			break;
+		}
+	}
+	
+	if (begin != end)
+		quote_can_start = end == quoted_end || !isScalarChar(end[-1]);
+	
+	offset += end - begin;
+	if (expect == Expect::Error)
+		boundary = offset;
+	return boundary;
+}
+
+void FeedScanner::scanTopLevel(const char * begin, const char * & position)
+{
+	char c = *position++;
+	if (isSpaceChar(c))
+		return;
+	if (c == '#')
+	{
+		mode = Mode::Comment;
+		return;
+	}
+	
+	// A node ends where the next one begins, unless its value continues as a list
+	if (expect == Expect::AfterValue && c != ',')
+	{
+		boundary = offset + (position - 1 - begin);
+		expect = Expect::Name;
+	}
+	
+	bool after_name = expect == Expect::AfterName || expect == Expect::AfterIdentifier;
+	switch (c)
+	{
+	case '=':
+		expect = after_name ? Expect::Value : Expect::Error;
+		break;
+	case ';':
+		expect = after_name || expect == Expect::Value ? Expect::AfterValue : Expect::Error;
+		break;
+	case ',':
+		expect = expect == Expect::AfterValue ? Expect::Value : Expect::Error;
+		break;
+	case '{':
+	case '[':
+		if ((c == '{' && after_name) || expect == Expect::Value)
+			depth = 1;
+		else
+			expect = Expect::Error;
+		break;
+	default:
+		// Quotes at the beginning of a token always start strings
+		if (c == '"' || c == '\'')
+		{
+			mode = Mode::Quoted;
+			quote = c;
+		}
+		else if (isScalarChar(c))
+			mode = Mode::Unquoted;
+		else
+			expect = Expect::Error;
+	}
+}
+
+void FeedScanner::endScalar()
+{
+	switch (expect)
+	{
+	case Expect::Name:
+		expect = Expect::AfterName;
+		break;
+	case Expect::AfterName:
+		expect = Expect::AfterIdentifier;
+		break;
+	case Expect::Value:
+		expect = Expect::AfterValue;
+		break;
+	default:
+		expect = Expect::Error;
+	}
+}
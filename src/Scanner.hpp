@@ -0,0 +1,258 @@
+#ifndef _PPK_SCANNER_HPP
+#define _PPK_SCANNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PPK_SCANNER_SSE2
+#endif
+
+
+namespace ppk
+{
+namespace detail
+{
+
+/*
+ * Functions finding the first character of some kind in a range, checking many
+ * characters at once with SSE2 or AVX2 where available. They return end if
+ * there is no such character. Characters are classified like in "C" locale.
+ */
+
+// Classes of characters, as bits
+enum CharClass : unsigned char
+{
+	scalar_char = 1,  // Can be a part of not quoted scalar: graphical, but not one of "=;{}[],#"
+	space_char = 2    // Whitespace
+};
+
+extern const unsigned char char_classes[256];
+
+inline bool isScalarChar(char c)
+{
+	return char_classes[static_cast<unsigned char>(c)] & scalar_char;
+}
+
+inline bool isSpaceChar(char c)
+{
+	return char_classes[static_cast<unsigned char>(c)] & space_char;
+}
+
+
+#if defined(__AVX2__)
+
+typedef __m256i Vector;
+const size_t vector_size = 32;
+
+inline Vector load(const char * p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)); }
+inline Vector splat(char c) { return _mm256_set1_epi8(c); }
+inline Vector equal(Vector a, Vector b) { return _mm256_cmpeq_epi8(a, b); }
+inline Vector greater(Vector a, Vector b) { return _mm256_cmpgt_epi8(a, b); }
+inline Vector either(Vector a, Vector b) { return _mm256_or_si256(a, b); }
+inline Vector both(Vector a, Vector b) { return _mm256_and_si256(a, b); }
+inline unsigned mask(Vector v) { return static_cast<unsigned>(_mm256_movemask_epi8(v)); }
+#define PPK_SCANNER_VECTORS
+
+#elif defined(PPK_SCANNER_SSE2)
+
+typedef __m128i Vector;
+const size_t vector_size = 16;
+
+inline Vector load(const char * p) { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p)); }
+inline Vector splat(char c) { return _mm_set1_epi8(c); }
+inline Vector equal(Vector a, Vector b) { return _mm_cmpeq_epi8(a, b); }
+inline Vector greater(Vector a, Vector b) { return _mm_cmpgt_epi8(a, b); }
+inline Vector either(Vector a, Vector b) { return _mm_or_si128(a, b); }
+inline Vector both(Vector a, Vector b) { return _mm_and_si128(a, b); }
+inline unsigned mask(Vector v) { return static_cast<unsigned>(_mm_movemask_epi8(v)); }
+#define PPK_SCANNER_VECTORS
+
+#endif
+
+
+#ifdef PPK_SCANNER_VECTORS
+
+inline unsigned firstBit(unsigned bits)
+{
+#if defined(__GNUC__)
+	return __builtin_ctz(bits);
+#else
+	unsigned i = 0;
+	while (!(bits & 1))
+	{
+		bits >>= 1;
+		++i;
+	}
+	return i;
+#endif
+}
+
+// Bytes that are not scalar characters. Comparisons are signed, so bytes >= 0x80 are below '!'.
+inline unsigned notScalarMask(Vector v)
+{
+	Vector r = either(greater(splat('!'), v), equal(v, splat('\x7f')));
+	r = either(r, either(equal(v, splat('=')), equal(v, splat(';'))));
+	r = either(r, either(equal(v, splat('{')), equal(v, splat('}'))));
+	r = either(r, either(equal(v, splat('[')), equal(v, splat(']'))));
+	r = either(r, either(equal(v, splat(',')), equal(v, splat('#'))));
+	return mask(r);
+}
+
+// Bytes that are not whitespaces: ' ' and '\t' to '\r'
+inline unsigned notSpaceMask(Vector v)
+{
+	Vector r = either(equal(v, splat(' ')), both(greater(v, splat('\x08')), greater(splat('\x0e'), v)));
+	return ~mask(r) & ((vector_size == 32) ? ~0u : 0xffffu);
+}
+
+#endif
+
+
+// Returns the first character which can't be a part of not quoted scalar
+inline const char * findScalarEnd(const char * begin, const char * end)
+{
+#ifdef PPK_SCANNER_VECTORS
+	for (; end - begin >= static_cast<ptrdiff_t>(vector_size); begin += vector_size)
+	{
+		unsigned bits = notScalarMask(load(begin));
+		if (bits)
+			return begin + firstBit(bits);
+	}
+#endif
+	while (begin != end && isScalarChar(*begin))
+		++begin;
+	return begin;
+}
+
+// Returns the first character which isn't a whitespace
+inline const char * findNotSpace(const char * begin, const char * end)
+{
+	// Usually there are only a few whitespaces, check them before loading whole vectors.
+	for (int i = 0; i < 4; i++, ++begin)
+		if (begin == end || !isSpaceChar(*begin))
+			return begin;
+
+#ifdef PPK_SCANNER_VECTORS
+	for (; end - begin >= static_cast<ptrdiff_t>(vector_size); begin += vector_size)
+	{
+		unsigned bits = notSpaceMask(load(begin));
+		if (bits)
+			return begin + firstBit(bits);
+	}
+#endif
+	while (begin != end && isSpaceChar(*begin))
+		++begin;
+	return begin;
+}
+
+// Returns the first quote or backslash
+inline const char * findQuoteOrEscape(const char * begin, const char * end, char quote)
+{
+#ifdef PPK_SCANNER_VECTORS
+	Vector quotes = splat(quote), backslashes = splat('\\');
+	for (; end - begin >= static_cast<ptrdiff_t>(vector_size); begin += vector_size)
+	{
+		Vector v = load(begin);
+		unsigned bits = mask(either(equal(v, quotes), equal(v, backslashes)));
+		if (bits)
+			return begin + firstBit(bits);
+	}
+#endif
+	while (begin != end && *begin != quote && *begin != '\\')
+		++begin;
+	return begin;
+}
+
+// Returns the first '\n'
+inline const char * findNewline(const char * begin, const char * end)
+{
+	const void * found = memchr(begin, '\n', end - begin);
+	return found ? static_cast<const char *>(found) : end;
+}
+
+// Returns the first character which isn't a whitespace nor a part of comment
+inline const char * skipSpacesAndComments(const char * begin, const char * end)
+{
+	begin = findNotSpace(begin, end);
+	while (begin != end && *begin == '#')
+		begin = findNotSpace(findNewline(begin, end), end);
+	return begin;
+}
+
+// Returns the first bracket, quote or '#'
+inline const char * findSpecial(const char * begin, const char * end)
+{
+#ifdef PPK_SCANNER_VECTORS
+	for (; end - begin >= static_cast<ptrdiff_t>(vector_size); begin += vector_size)
+	{
+		Vector v = load(begin);
+		Vector r = either(equal(v, splat('{')), equal(v, splat('}')));
+		r = either(r, either(equal(v, splat('[')), equal(v, splat(']'))));
+		r = either(r, either(equal(v, splat('"')), equal(v, splat('\''))));
+		unsigned bits = mask(either(r, equal(v, splat('#'))));
+		if (bits)
+			return begin + firstBit(bits);
+	}
+#endif
+	while (begin != end && *begin != '{' && *begin != '}' && *begin != '[' && *begin != ']'
+	       && *begin != '"' && *begin != '\'' && *begin != '#')
+		++begin;
+	return begin;
+}
+
+
+/*
+ * Functions finding structure of data without parsing it. They follow only brackets, quoted
+ * strings and comments, so they give correct results for correct data. For incorrect data
+ * results are unspecified, but the parser finds the error before reaching them.
+ */
+
+// Returns position after the bracket matching the one at begin, or NULL if there is none.
+const char * skipBrackets(const char * begin, const char * end);
+
+// Returns positions between top-level nodes, where data can be split into parts that
+// are parsed separately. Parts are at least min_size long, except the last one.
+std::vector<const char *> findSplitPoints(const char * begin, const char * end, size_t min_size);
+
+
+// Finds ends of top-level nodes in data which comes in chunks, e.g. from a pipe. The state is
+// kept between chunks, so they can end anywhere, even inside a string or a comment. Unlike the
+// functions above, it follows tokens at the top level, as a node like a = 1 ends only where
+// the next one begins.
+class FeedScanner
+{
+public:
+	FeedScanner();
+
+	// Scans the next chunk. Returns the offset, counted from the beginning of all data, up to which
+	// the data consists of whole top-level nodes. For incorrect data it returns the offset of its end,
+	// so that the parser finds the error.
+	uint64_t scan(const char * begin, const char * end);
+
+private:
+	enum class Mode : unsigned char { Space, Unquoted, Quoted, Escape, Comment };
+	enum class Expect : unsigned char { Name, AfterName, AfterIdentifier, Value, AfterValue, Error };
+
+	Mode mode;
+	Expect expect;  // Next token at the top level
+	char quote;  // Of the current quoted string
+	bool quote_can_start;  // A quote after the last scanned character would start a string
+	size_t depth;  // Of brackets
+	uint64_t offset;  // Of the beginning of the chunk
+	uint64_t boundary;
+
+	void scanTopLevel(const char * begin, const char * & position);  // the character at position
+	void endScalar();
+};
+
+}
+}
+
+
+#endif //_PPK_SCANNER_HPP
@@ -0,0 +1,503 @@
+#include "StandardConverters.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <locale.h>
+
+#if defined(__APPLE__)
+#include <xlocale.h>
+#endif
+
+using namespace ppk;
+using namespace ppk::detail;
+
+namespace
+{
+
+typedef unsigned long long Magnitude;
+
+// Numbers at most this long are parsed by the C library without allocating
+const size_t number_buffer_size = 128;
+
+// Gives printf() and strtod() of the "C" locale, with '.' as the decimal point, whatever the locale
+// of the program is. No global state is changed, so other threads are not affected.
+#if defined(_WIN32)
+
+class ClassicLocale
+{
+public:
+	float parse(const char * text, char ** end, float) { return _strtof_l(text, end, get()); }
+	double parse(const char * text, char ** end, double) { return _strtod_l(text, end, get()); }
+	long double parse(const char * text, char ** end, long double) { return _strtold_l(text, end, get()); }
+
+	int print(char * buffer, size_t size, double in) { return _snprintf_l(buffer, size, "%g", get(), in); }
+	int print(char * buffer, size_t size, long double in) { return _snprintf_l(buffer, size, "%Lg", get(), in); }
+
+private:
+	static _locale_t get()
+	{
+		static const _locale_t locale = _create_locale(LC_ALL, "C");
+		return locale;
+	}
+};
+
+#else
+
+// Switches the calling thread to the "C" locale while it exists
+class ClassicLocale
+{
+public:
+	ClassicLocale() : previous(uselocale(get())) {}
+	ClassicLocale(const ClassicLocale &) = delete;
+	const ClassicLocale & operator=(const ClassicLocale &) = delete;
+	~ClassicLocale() { uselocale(previous); }
+
+	float parse(const char * text, char ** end, float) { return strtof(text, end); }
+	double parse(const char * text, char ** end, double) { return strtod(text, end); }
+	long double parse(const char * text, char ** end, long double) { return strtold(text, end); }
+
+	int print(char * buffer, size_t size, double in) { return snprintf(buffer, size, "%g", in); }
+	int print(char * buffer, size_t size, long double in) { return snprintf(buffer, size, "%Lg", in); }
+
+private:
+	locale_t previous;
+
+	// If the locale can't be made, uselocale() only returns the current one
+	static locale_t get()
+	{
+		static const locale_t locale = newlocale(LC_ALL_MASK, "C", static_cast<locale_t>(0));
+		return locale;
+	}
+};
+
+#endif
+
+const Magnitude eight_digits = 100000000;
+
+// Parses 8 decimal digits at once, like in SIMD libraries but within a single register.
+// Returns false if some of the characters isn't a digit.
+bool parseEightDigits(const char * p, Magnitude & out)
+{
+#if (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) || defined(_M_X64) || defined(_M_IX86)
+	uint64_t chunk;
+	memcpy(&chunk, p, 8);
+
+	// Digits have high nibble 3, and adding 6 to them doesn't change it
+	const uint64_t high = 0xf0f0f0f0f0f0f0f0ull, threes = 0x3030303030303030ull;
+	if ((chunk & high) != threes || ((chunk + 0x0606060606060606ull) & high) != threes)
+		return false;
+
+	// Pairs of digits, then groups of four, then all eight; the first character is the most significant
+	chunk -= threes;
+	chunk = chunk * 10 + (chunk >> 8);
+	chunk = ((chunk & 0x000000ff000000ffull) * (100 + (1000000ull << 32))
+	         + ((chunk >> 16) & 0x000000ff000000ffull) * (1 + (10000ull << 32))) >> 32;
+	out = chunk;
+	return true;
+#else
+	Magnitude value = 0;
+	for (int i = 0; i < 8; i++)
+	{
+		if (p[i] < '0' || p[i] > '9')
+			return false;
+		value = value * 10 + (p[i] - '0');
+	}
+	out = value;
+	return true;
+#endif
+}
+
+// Value of a digit, or base if it isn't a digit in the base
+unsigned digitValue(char c, unsigned base)
+{
+	unsigned value;
+	if (c >= '0' && c <= '9')
+		value = c - '0';
+	else if (c >= 'a' && c <= 'f')
+		value = c - 'a' + 10;
+	else if (c >= 'A' && c <= 'F')
+		value = c - 'A' + 10;
+	else
+		return base;
+
+	return value < base ? value : base;
+}
+
+// Parses sign and digits of an integer, with base given by its prefix like in strtol()
+bool parseInteger(const StringRef & str, bool & negative, Magnitude & out)
+{
+	const char * p = str.begin(), * end = str.end();
+
+	negative = p != end && *p == '-';
+	if (p != end && (*p == '-' || *p == '+'))
+		++p;
+
+	unsigned base = 10;
+	if (end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X'))
+	{
+		base = 16;
+		p += 2;
+	}
+	else if (end - p > 1 && p[0] == '0')
+		base = 8;
+
+	if (p == end)
+		return false;
+
+	Magnitude value = 0, chunk;
+	if (base == 10)
+		for (; end - p >= 8 && parseEightDigits(p, chunk); p += 8)
+		{
+			if (value > (std::numeric_limits<Magnitude>::max() - chunk) / eight_digits)
+				return false;
+			value = value * eight_digits + chunk;
+		}
+
+	for (; p != end; ++p)
+	{
+		unsigned digit = digitValue(*p, base);
+		if (digit == base || value > (std::numeric_limits<Magnitude>::max() - digit) / base)
+			return false;
+		value = value * base + digit;
+	}
+
+	out = value;
+	return true;
+}
+
+template <class T>
+bool parseSigned(const StringRef & str, T & out)
+{
+	bool negative;
+	Magnitude magnitude;
+	if (!parseInteger(str, negative, magnitude))
+		return false;
+
+	Magnitude limit = static_cast<Magnitude>(std::numeric_limits<T>::max()) + (negative ? 1 : 0);
+	if (magnitude > limit)
+		return false;
+
+	// The most negative value can't be negated as T
+	out = (negative && magnitude) ? static_cast<T>(-static_cast<T>(magnitude - 1) - 1) : static_cast<T>(magnitude);
+	return true;
+}
+
+template <class T>
+bool parseUnsigned(const StringRef & str, T & out)
+{
+	bool negative;
+	Magnitude magnitude;
+	if (!parseInteger(str, negative, magnitude) || magnitude > std::numeric_limits<T>::max())
+		return false;
+
+	// Negative values wrap around, like in strtoul()
+	out = negative ? static_cast<T>(0 - static_cast<T>(magnitude)) : static_cast<T>(magnitude);
+	return true;
+}
+
+template <class T>
+bool parseCharacter(const StringRef & str, T & out)
+{
+	if (str.size() != 1)
+		return false;
+
+	out = static_cast<T>(str[0]);
+	return true;
+}
+
+
+// Largest power of 10 that T represents exactly, so that converting mantissas below 2^digits is correctly rounded
+template <class T>
+int exactPowers()
+{
+	return std::numeric_limits<T>::digits >= 64 ? 27 : std::numeric_limits<T>::digits >= 53 ? 22 : 10;
+}
+
+template <class T>
+T powerOf10(int exponent)
+{
+	T result = 1;
+	for (T base = 10; exponent; exponent >>= 1, base *= base)
+		if (exponent & 1)
+			result *= base;
+	return result;
+}
+
+template <class T>
+bool parseFloat(const StringRef & str, T & out)
+{
+	if (str == "inf" || str == "-inf" || str == "nan" || str == "-nan")
+	{
+		T value = (str[str.size() - 1] == 'f') ? std::numeric_limits<T>::infinity() : std::numeric_limits<T>::quiet_NaN();
+		out = (str[0] == '-') ? -value : value;
+		return true;
+	}
+
+	const char * p = str.begin(), * end = str.end();
+	bool negative = p != end && *p == '-';
+	if (p != end && (*p == '-' || *p == '+'))
+		++p;
+
+	// Digits which fit in the mantissa, then the exponent of 10 to multiply it by
+	Magnitude mantissa = 0, chunk;
+	int exponent = 0;
+	bool any_digits = false, exact = true;
+	const Magnitude mantissa_limit = (std::numeric_limits<Magnitude>::max() - 9) / 10;
+	const Magnitude chunk_limit = (std::numeric_limits<Magnitude>::max() - (eight_digits - 1)) / eight_digits;
+
+	for (; end - p >= 8 && mantissa <= chunk_limit && parseEightDigits(p, chunk); p += 8)
+	{
+		any_digits = true;
+		mantissa = mantissa * eight_digits + chunk;
+	}
+
+	for (; p != end && *p >= '0' && *p <= '9'; ++p)
+	{
+		any_digits = true;
+		if (mantissa <= mantissa_limit)
+			mantissa = mantissa * 10 + (*p - '0');
+		else
+			exact = false;
+	}
+
+	if (p != end && *p == '.')
+	{
+		for (++p; end - p >= 8 && mantissa <= chunk_limit && parseEightDigits(p, chunk); p += 8)
+		{
+			any_digits = true;
+			mantissa = mantissa * eight_digits + chunk;
+			exponent -= 8;
+		}
+
+		for (; p != end && *p >= '0' && *p <= '9'; ++p)
+		{
+			any_digits = true;
+			if (mantissa <= mantissa_limit)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				exponent--;
+			}
+			else
+				exact = false;
+		}
+	}
+
+	if (!any_digits)
+		return false;
+
+	if (p != end && (*p == 'e' || *p == 'E'))
+	{
+		++p;
+		bool negative_exponent = p != end && *p == '-';
+		if (p != end && (*p == '-' || *p == '+'))
+			++p;
+
+		if (p == end)
+			return false;
+
+		int value = 0;
+		for (; p != end && *p >= '0' && *p <= '9'; ++p)
+		{
+			if (value < 100000)
+				value = value * 10 + (*p - '0');
+			else
+				exact = false;
+		}
+		exponent += negative_exponent ? -value : value;
+	}
+
+	if (p != end)
+		return false;
+
+	// Both the mantissa and the power are exact, so one multiplication or division rounds correctly.
+	const Magnitude max_mantissa = Magnitude(1) << std::min(std::numeric_limits<T>::digits, 63);
+	if (exact && mantissa <= max_mantissa && exponent >= -exactPowers<T>() && exponent <= exactPowers<T>())
+	{
+		T value = static_cast<T>(mantissa);
+		value = (exponent < 0) ? value / powerOf10<T>(-exponent) : value * powerOf10<T>(exponent);
+		out = negative ? -value : value;
+		return true;
+	}
+
+	// Rare, long numbers are converted by the C library, in the "C" locale. They are copied to be
+	// terminated by zero, on the stack unless they are very long. Values too large for T are rejected,
+	// too small ones become 0 or denormal.
+	char text[number_buffer_size];
+	std::string long_text;
+	const char * terminated = text;
+	if (str.size() < sizeof(text))
+	{
+		memcpy(text, str.data(), str.size());
+		text[str.size()] = '\0';
+	}
+	else
+	{
+		long_text = str.str();
+		terminated = long_text.c_str();
+	}
+
+	T value;
+	char * parsed_end;
+	errno = 0;
+	{
+		ClassicLocale locale;
+		value = locale.parse(terminated, &parsed_end, T());
+	}
+	if (parsed_end != terminated + str.size() || (errno == ERANGE && std::isinf(value)))
+		return false;
+
+	out = value;
+	return true;
+}
+
+
+template <class T>
+size_t formatSigned(T in, char * buffer)
+{
+	// The most negative value can't be negated as T
+	Magnitude magnitude = (in < 0) ? Magnitude(-(in + 1)) + 1 : Magnitude(in);
+
+	char digits[24];
+	char * p = digits + sizeof(digits);
+	do
+	{
+		*--p = '0' + magnitude % 10;
+		magnitude /= 10;
+	}
+	while (magnitude);
+
+	if (in < 0)
+		*--p = '-';
+
+	size_t length = digits + sizeof(digits) - p;
+	memcpy(buffer, p, length);
+	return length;
+}
+
+template <class T>
+size_t formatUnsigned(T in, char * buffer)
+{
+	Magnitude magnitude = in;
+
+	char digits[24];
+	char * p = digits + sizeof(digits);
+	do
+	{
+		*--p = '0' + magnitude % 10;
+		magnitude /= 10;
+	}
+	while (magnitude);
+
+	size_t length = digits + sizeof(digits) - p;
+	memcpy(buffer, p, length);
+	return length;
+}
+
+template <class T>
+size_t formatCharacter(T in, char * buffer)
+{
+	buffer[0] = static_cast<char>(in);
+	return 1;
+}
+
+template <class T>
+size_t formatFloat(T in, char * buffer)
+{
+	// With the terminating zero, which isn't a part of the text
+	char text[number_text_size + 1];
+	int length;
+	{
+		ClassicLocale locale;
+		length = locale.print(text, sizeof(text), in);
+	}
+	if (length < 0)
+		length = 0;
+
+	size_t size = std::min(static_cast<size_t>(length), number_text_size);
+	memcpy(buffer, text, size);
+	return size;
+}
+
+template <class T>
+std::string formatString(T in)
+{
+	char buffer[number_text_size];
+	return std::string(buffer, formatNumber(in, buffer));
+}
+
+}
+
+
+bool detail::parseNumber(const StringRef & str, bool & out)
+{
+	if (str == "true")
+		out = true;
+	else if (str == "false")
+		out = false;
+	else
+		return false;
+
+	return true;
+}
+
+bool detail::parseNumber(const StringRef & str, int & out) { return parseSigned(str, out); }
+bool detail::parseNumber(const StringRef & str, short & out) { return parseSigned(str, out); }
+bool detail::parseNumber(const StringRef & str, long & out) { return parseSigned(str, out); }
+bool detail::parseNumber(const StringRef & str, long long & out) { return parseSigned(str, out); }
+bool detail::parseNumber(const StringRef & str, unsigned & out) { return parseUnsigned(str, out); }
+bool detail::parseNumber(const StringRef & str, unsigned short & out) { return parseUnsigned(str, out); }
+bool detail::parseNumber(const StringRef & str, unsigned long & out) { return parseUnsigned(str, out); }
+bool detail::parseNumber(const StringRef & str, unsigned long long & out) { return parseUnsigned(str, out); }
+bool detail::parseNumber(const StringRef & str, char & out) { return parseCharacter(str, out); }
+bool detail::parseNumber(const StringRef & str, signed char & out) { return parseCharacter(str, out); }
+bool detail::parseNumber(const StringRef & str, unsigned char & out) { return parseCharacter(str, out); }
+bool detail::parseNumber(const StringRef & str, float & out) { return parseFloat(str, out); }
+bool detail::parseNumber(const StringRef & str, double & out) { return parseFloat(str, out); }
+bool detail::parseNumber(const StringRef & str, long double & out) { return parseFloat(str, out); }
+
+
+size_t detail::formatNumber(bool in, char * buffer)
+{
+	const char * text = in ? "true" : "false";
+	size_t length = strlen(text);
+	memcpy(buffer, text, length);
+	return length;
+}
+
+size_t detail::formatNumber(int in, char * buffer) { return formatSigned(in, buffer); }
+size_t detail::formatNumber(short in, char * buffer) { return formatSigned(in, buffer); }
+size_t detail::formatNumber(long in, char * buffer) { return formatSigned(in, buffer); }
+size_t detail::formatNumber(long long in, char * buffer) { return formatSigned(in, buffer); }
+size_t detail::formatNumber(unsigned in, char * buffer) { return formatUnsigned(in, buffer); }
+size_t detail::formatNumber(unsigned short in, char * buffer) { return formatUnsigned(in, buffer); }
+size_t detail::formatNumber(unsigned long in, char * buffer) { return formatUnsigned(in, buffer); }
+size_t detail::formatNumber(unsigned long long in, char * buffer) { return formatUnsigned(in, buffer); }
+size_t detail::formatNumber(char in, char * buffer) { return formatCharacter(in, buffer); }
+size_t detail::formatNumber(signed char in, char * buffer) { return formatCharacter(in, buffer); }
+size_t detail::formatNumber(unsigned char in, char * buffer) { return formatCharacter(in, buffer); }
+size_t detail::formatNumber(float in, char * buffer) { return formatFloat(static_cast<double>(in), buffer); }
+size_t detail::formatNumber(double in, char * buffer) { return formatFloat(in, buffer); }
+size_t detail::formatNumber(long double in, char * buffer) { return formatFloat(in, buffer); }
+
+
+std::string detail::formatNumber(bool in) { return formatString(in); }
+std::string detail::formatNumber(int in) { return formatString(in); }
+std::string detail::formatNumber(short in) { return formatString(in); }
+std::string detail::formatNumber(long in) { return formatString(in); }
+std::string detail::formatNumber(long long in) { return formatString(in); }
+std::string detail::formatNumber(unsigned in) { return formatString(in); }
+std::string detail::formatNumber(unsigned short in) { return formatString(in); }
+std::string detail::formatNumber(unsigned long in) { return formatString(in); }
+std::string detail::formatNumber(unsigned long long in) { return formatString(in); }
+std::string detail::formatNumber(char in) { return formatString(in); }
+std::string detail::formatNumber(signed char in) { return formatString(in); }
+std::string detail::formatNumber(unsigned char in) { return formatString(in); }
+std::string detail::formatNumber(float in) { return formatString(in); }
+std::string detail::formatNumber(double in) { return formatString(in); }
+std::string detail::formatNumber(long double in) { return formatString(in); }
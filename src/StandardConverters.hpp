@@ -8,8 +8,8 @@
 
 
 #include "Node.hpp"
-#include <sstream>
-#include <limits>
+#include "StringRef.hpp"
+#include <string>
 
 namespace ppk
 {
@@ -28,93 +28,132 @@ public:
 		return node.getType() == Node::Type::Scalar;
 	}
 	
+	static bool fromString(const StringRef & str, std::string & out)
+	{
+		out = str;
+		return true;
+	}
+	
 	static void toNode(Node & node, const std::string & in)
 	{
 		node.setScalar(in);
 	}
 };
 
-#define PPK_DEFINE_STREAMABLE_CONVERTER(Streamable)\
+namespace detail
+{
+
+/*
+ * Conversions of numbers, independent of locale. Integers can be decimal, hexadecimal (0x1f)
+ * or octal (017), unsigned ones can be negative like in strtoul(). Floating-point numbers can be
+ * also inf, -inf, nan and -nan, and bools are true or false. Characters are single characters.
+ * Values out of range are not converted.
+ */
+bool parseNumber(const StringRef & str, bool & out);
+bool parseNumber(const StringRef & str, int & out);
+bool parseNumber(const StringRef & str, short & out);
+bool parseNumber(const StringRef & str, long & out);
+bool parseNumber(const StringRef & str, long long & out);
+bool parseNumber(const StringRef & str, unsigned & out);
+bool parseNumber(const StringRef & str, unsigned short & out);
+bool parseNumber(const StringRef & str, unsigned long & out);
+bool parseNumber(const StringRef & str, unsigned long long & out);
+bool parseNumber(const StringRef & str, char & out);
+bool parseNumber(const StringRef & str, signed char & out);
+bool parseNumber(const StringRef & str, unsigned char & out);
+bool parseNumber(const StringRef & str, float & out);
+bool parseNumber(const StringRef & str, double & out);
+bool parseNumber(const StringRef & str, long double & out);
+
+// Longest text of a number written by formatNumber()
+const size_t number_text_size = 32;
+
+/*
+ * Writes numbers into a buffer of number_text_size characters, without terminating zero, and
+ * returns the length. Floating-point numbers are written like by printf("%g") in "C" locale.
+ * Nothing is allocated.
+ */
+size_t formatNumber(bool in, char * buffer);
+size_t formatNumber(int in, char * buffer);
+size_t formatNumber(short in, char * buffer);
+size_t formatNumber(long in, char * buffer);
+size_t formatNumber(long long in, char * buffer);
+size_t formatNumber(unsigned in, char * buffer);
+size_t formatNumber(unsigned short in, char * buffer);
+size_t formatNumber(unsigned long in, char * buffer);
+size_t formatNumber(unsigned long long in, char * buffer);
+size_t formatNumber(char in, char * buffer);
+size_t formatNumber(signed char in, char * buffer);
+size_t formatNumber(unsigned char in, char * buffer);
+size_t formatNumber(float in, char * buffer);
+size_t formatNumber(double in, char * buffer);
+size_t formatNumber(long double in, char * buffer);
+
+// Like above, but returns a string. Short ones fit in the string itself in common implementations, so they aren't allocated either.
+std::string formatNumber(bool in);
+std::string formatNumber(int in);
+std::string formatNumber(short in);
+std::string formatNumber(long in);
+std::string formatNumber(long long in);
+std::string formatNumber(unsigned in);
+std::string formatNumber(unsigned short in);
+std::string formatNumber(unsigned long in);
+std::string formatNumber(unsigned long long in);
+std::string formatNumber(char in);
+std::string formatNumber(signed char in);
+std::string formatNumber(unsigned char in);
+std::string formatNumber(float in);
+std::string formatNumber(double in);
+std::string formatNumber(long double in);
+
+}
+
+#define PPK_DEFINE_NUMERIC_CONVERTER(Number)\
 	template<>\
-	class Converter<Streamable>\
+	class Converter<Number>\
 	{\
 	public:\
-		static constexpr const char * type_name = #Streamable;\
+		static constexpr const char * type_name = #Number;\
 		\
-		static bool fromNode(const Node & node, Streamable & out)\
+		static bool fromNode(const Node & node, Number & out)\
 		{\
 			if (node.getType() != Node::Type::Scalar)\
 				return false;\
 			\
-			const std::string & str = node.getScalar();\
-			\
-			if (std::numeric_limits<Streamable>::has_infinity)\
-			{\
-				if (str == "inf")\
-				{\
-					out = std::numeric_limits<Streamable>::infinity();\
-					return true;\
-				}\
-				if (std::numeric_limits<Streamable>::is_signed && str == "-inf")\
-				{\
-					out = -std::numeric_limits<Streamable>::infinity();\
-					return true;\
-				}\
-			}\
-			\
-			if (std::numeric_limits<Streamable>::has_quiet_NaN)\
-			{\
-				if (str == "nan")\
-				{\
-					out = std::numeric_limits<Streamable>::quiet_NaN();\
-					return true;\
-				}\
-				if (std::numeric_limits<Streamable>::is_signed && str == "-nan")\
-				{\
-					out = -std::numeric_limits<Streamable>::quiet_NaN();\
-					return true;\
-				}\
-			}\
-			\
-			std::stringstream stream(str);\
-			stream.unsetf(std::ios::dec);\
-			stream >> std::noskipws >> std::boolalpha >> out;\
-			stream.peek();\
-			\
-			if (stream.eof())\
-				return true;\
-			\
-			return false;\
+			return fromString(node.getScalar(), out);\
+		}\
+		\
+		static bool fromString(const StringRef & str, Number & out)\
+		{\
+			return detail::parseNumber(str, out);\
 		}\
 		\
-		static void toNode(Node & node, const Streamable & in)\
+		static void toNode(Node & node, const Number & in)\
 		{\
-			std::stringstream stream;\
-			stream << std::boolalpha << in;\
-			node.setScalar(stream.str());\
+			node.setScalar(detail::formatNumber(in));\
 		}\
 	};
 
-PPK_DEFINE_STREAMABLE_CONVERTER(bool)
+PPK_DEFINE_NUMERIC_CONVERTER(bool)
 
-PPK_DEFINE_STREAMABLE_CONVERTER(int)
-PPK_DEFINE_STREAMABLE_CONVERTER(short)
-PPK_DEFINE_STREAMABLE_CONVERTER(long)
-PPK_DEFINE_STREAMABLE_CONVERTER(long long)
-PPK_DEFINE_STREAMABLE_CONVERTER(unsigned)
-PPK_DEFINE_STREAMABLE_CONVERTER(unsigned short)
-PPK_DEFINE_STREAMABLE_CONVERTER(unsigned long)
-PPK_DEFINE_STREAMABLE_CONVERTER(unsigned long long)
+PPK_DEFINE_NUMERIC_CONVERTER(int)
+PPK_DEFINE_NUMERIC_CONVERTER(short)
+PPK_DEFINE_NUMERIC_CONVERTER(long)
+PPK_DEFINE_NUMERIC_CONVERTER(long long)
+PPK_DEFINE_NUMERIC_CONVERTER(unsigned)
+PPK_DEFINE_NUMERIC_CONVERTER(unsigned short)
+PPK_DEFINE_NUMERIC_CONVERTER(unsigned long)
+PPK_DEFINE_NUMERIC_CONVERTER(unsigned long long)
 
-PPK_DEFINE_STREAMABLE_CONVERTER(char)
-PPK_DEFINE_STREAMABLE_CONVERTER(signed char)
-PPK_DEFINE_STREAMABLE_CONVERTER(unsigned char)
+PPK_DEFINE_NUMERIC_CONVERTER(char)
+PPK_DEFINE_NUMERIC_CONVERTER(signed char)
+PPK_DEFINE_NUMERIC_CONVERTER(unsigned char)
 
-PPK_DEFINE_STREAMABLE_CONVERTER(float)
-PPK_DEFINE_STREAMABLE_CONVERTER(double)
-PPK_DEFINE_STREAMABLE_CONVERTER(long double)
+PPK_DEFINE_NUMERIC_CONVERTER(float)
+PPK_DEFINE_NUMERIC_CONVERTER(double)
+PPK_DEFINE_NUMERIC_CONVERTER(long double)
 
-#undef PPK_DEFINE_STREAMABLE_CONVERTER
+#undef PPK_DEFINE_NUMERIC_CONVERTER
 ///@endcond
 
 }
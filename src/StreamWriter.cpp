@@ -0,0 +1,162 @@
+#include "StreamWriter.hpp"
+
+#include <stdexcept>
+
+#include "TextWriter.hpp"
+
+using namespace ppk;
+using namespace ppk::detail;
+
+StreamWriter::StreamWriter() :
+    file(NULL),
+    compact(false)
+{
+}
+
+StreamWriter::StreamWriter(std::ostream & stream) :
+    file(NULL),
+    compact(false)
+{
+	reset(new TextWriter(stream));
+}
+
+StreamWriter::StreamWriter(std::string & output) :
+    file(NULL),
+    compact(false)
+{
+	reset(new TextWriter(output));
+}
+
+StreamWriter::~StreamWriter()
+{
+	close();
+}
+
+bool StreamWriter::open(const std::string & path)
+{
+	close();
+
+	file = fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		errorMsg = "Error in \"" + path + "\": can't open";
+		return false;
+	}
+
+	reset(new TextWriter(file));
+	return true;
+}
+
+bool StreamWriter::close()
+{
+	if (!writer)
+		return true;
+
+	while (stack.size() > 1)
+		end();
+
+	writer->flush(true);
+	bool result = !writer->hasFailed();
+	writer.reset();
+
+	if (file && fclose(file) != 0)
+		result = false;
+	file = NULL;
+
+	if (!result)
+		errorMsg = "Error: can't write";
+	return result;
+}
+
+const std::string & StreamWriter::getError() const
+{
+	return errorMsg;
+}
+
+void StreamWriter::beginGroup(const std::string & name, const std::string & identifier)
+{
+	beginNode(name, identifier);
+	writer->putHeader(name, identifier, Node::Type::Group, stack.size() - 1);
+	stack.push_back(std::make_pair(Node::Type::Group, 0));
+}
+
+void StreamWriter::beginList(const std::string & name, const std::string & identifier)
+{
+	// Like groups, lists are opened by their first element, and even their header depends on it
+	beginNode(name, identifier);
+	list_name = name;
+	list_identifier = identifier;
+	stack.push_back(std::make_pair(Node::Type::List, 0));
+}
+
+void StreamWriter::end()
+{
+	if (stack.size() < 2)
+		throw std::logic_error("There is no group nor list to end!");
+
+	std::pair<Node::Type, size_t> node = stack.back();
+	stack.pop_back();
+	int d = stack.size() - 1;
+
+	// Like in FS::write() of the tree read back, an empty group or list is written as a Null node
+	if (node.second == 0)
+	{
+		if (node.first == Node::Type::List)
+			writer->putHeader(list_name, list_identifier, Node::Type::Null, d);
+		scratch.clear();
+		writer->putContents(scratch, d);
+	}
+	else
+		writer->putClosing(node.first, d);
+
+	writer->flush();
+}
+
+void StreamWriter::setCompact(bool compact)
+{
+	this->compact = compact;
+	if (writer)
+		writer->setCompact(compact);
+}
+
+void StreamWriter::reset(TextWriter * output)
+{
+	writer.reset(output);
+	writer->setCompact(compact);
+	stack.assign(1, std::make_pair(Node::Type::Group, 0));
+}
+
+void StreamWriter::beginNode(const std::string & name, const std::string & identifier)
+{
+	if (!writer)
+		throw std::logic_error("StreamWriter has no output!");
+
+	// Checked like in Node, before anything is written
+	if (name.empty() && !identifier.empty())
+		throw std::domain_error("Nodes must have name before they could have an identifier!");
+
+	std::pair<Node::Type, size_t> & parent = stack.back();
+	if (parent.first == Node::Type::List && !name.empty())
+		throw std::domain_error("Children in lists cannot have names nor identifiers!");
+	if (parent.first == Node::Type::Group && name.empty())
+		throw std::domain_error("In a group everything must have a name!");
+
+	// Groups and lists are opened by their first child, as empty ones are written differently
+	int d = stack.size() - 1;
+	if (parent.second == 0 && d > 0)
+	{
+		if (parent.first == Node::Type::List)
+			writer->putHeader(list_name, list_identifier, Node::Type::List, d - 1);
+		writer->putOpening(parent.first);
+	}
+
+	writer->putSeparator(parent.first, parent.second++, d);
+}
+
+void StreamWriter::writeValue(const std::string & name, const std::string & identifier)
+{
+	beginNode(name, identifier);
+	writer->putHeader(name, identifier, scratch.getType(), stack.size() - 1);
+	writer->putContents(scratch, stack.size() - 1);
+	writer->flush();
+}
@@ -0,0 +1,141 @@
+#ifndef _PPK_STREAMWRITER_HPP
+#define _PPK_STREAMWRITER_HPP
+
+#include <cstdio>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Node.hpp"
+
+
+namespace ppk
+{
+
+namespace detail
+{
+class TextWriter;
+}
+
+
+
+/**
+ * @brief The StreamWriter class writes data in the format of FS::write() one node at a time.
+ *
+ * No tree is built, only the path to the current node is kept in memory, so the size
+ * of the output doesn't matter. The output can be read by FS::read(). For example:
+ * @code
+ * StreamWriter writer;
+ * writer.open("out.cl");
+ * writer.beginGroup("Tree", "larch");
+ *     writer.value("var", 3);
+ * writer.end();
+ * writer.beginList("a");
+ *     writer.value(1);
+ *     writer.value(2.5);
+ * writer.end();
+ * writer.close();
+ * @endcode
+ *
+ * Like in Node, top-level nodes and children of groups must have names,
+ * and elements of lists must not.
+ */
+class StreamWriter
+{
+public:
+	/// Constructs writer which writes nowhere until open() is called.
+	StreamWriter();
+
+	/// Constructs writer which writes to given stream. The stream must outlive it.
+	explicit StreamWriter(std::ostream & stream);
+
+	/// Constructs writer which appends to given string. The string must outlive it.
+	explicit StreamWriter(std::string & output);
+
+	/// Noncopyable.
+	StreamWriter(const StreamWriter &) = delete;
+
+	/// Nonassignable
+	StreamWriter & operator=(const StreamWriter &) = delete;
+
+	/// Closes the output, see close().
+	~StreamWriter();
+
+	/**
+	 * @brief Opens file at given path for writing.
+	 *
+	 * Previous output is closed first.
+	 * @return true if no errors happened @see getError()
+	 */
+	bool open(const std::string & path);
+
+	/**
+	 * @brief Ends all nodes which are not ended, writes everything and closes the file.
+	 * @return true if no errors happened since opening @see getError()
+	 */
+	bool close();
+
+	/// Returns the last error message.
+	const std::string & getError() const;
+
+	/**
+	 * @brief Sets if the output is compact, like FS::setCompact() makes it.
+	 * @param compact -- the default is false
+	 */
+	void setCompact(bool compact);
+
+
+	/**
+	 * @brief Begins a group. Its children are written until matching end().
+	 * @throws std::logic_error if there is no output
+	 * @throws std::domain_error if the name is wrong for this place, like in Node::insert()
+	 */
+	void beginGroup(const std::string & name = "", const std::string & identifier = "");
+
+	/**
+	 * @brief Begins a list. Its elements are written until matching end().
+	 * @see beginGroup()
+	 */
+	void beginList(const std::string & name = "", const std::string & identifier = "");
+
+	/**
+	 * @brief Ends the last group or list which was begun.
+	 * @throws std::logic_error if there is no such
+	 */
+	void end();
+
+
+	/**
+	 * @brief Writes an element of a list, converted by Converter<T>.
+	 * @see beginGroup()
+	 */
+	template <class T> void value(const T & value);
+
+	/// Writes a named node, converted by Converter<T>. @see beginGroup()
+	template <class T> void value(const std::string & name, const T & value);
+
+	/// Writes a named node with identifier, converted by Converter<T>. @see beginGroup()
+	template <class T> void value(const std::string & name, const std::string & identifier, const T & value);
+
+private:
+	std::unique_ptr<detail::TextWriter> writer;
+	FILE * file;  // Opened by open(), NULL otherwise
+	bool compact;
+	std::vector<std::pair<Node::Type, size_t>> stack;  // Type and number of children of the root and each begun node
+	Node scratch;  // The value being written
+	std::string list_name, list_identifier;  // Header of the last begun list, written with its first element
+	std::string errorMsg;
+
+	void reset(detail::TextWriter * output);
+	void beginNode(const std::string & name, const std::string & identifier);  // opens its parent and writes the separator
+	void writeValue(const std::string & name, const std::string & identifier);  // writes scratch as the node's value
+};
+
+}
+
+
+#include "StreamWriter.tpp"
+
+#endif //_PPK_STREAMWRITER_HPP
@@ -0,0 +1,31 @@
+#ifndef STREAMWRITER_TPP
+#define STREAMWRITER_TPP
+
+
+namespace ppk
+{
+
+
+template <class T>
+void StreamWriter::value(const T & value)
+{
+	this->value("", "", value);
+}
+
+template <class T>
+void StreamWriter::value(const std::string & name, const T & value)
+{
+	this->value(name, "", value);
+}
+
+template <class T>
+void StreamWriter::value(const std::string & name, const std::string & identifier, const T & value)
+{
+	// Converted before anything is written, so that a failed conversion doesn't break the output
+	scratch = value;
+	writeValue(name, identifier);
+}
+
+}
+
+#endif // STREAMWRITER_TPP
@@ -0,0 +1,96 @@
+#ifndef _PPK_STRINGREF_HPP
+#define _PPK_STRINGREF_HPP
+
+#include <cstring>
+#include <ostream>
+#include <string>
+
+namespace ppk
+{
+
+/**
+ * @brief The StringRef class is a read-only reference to characters owned by someone else.
+ *
+ * It converts implicitly to and from std::string and can be compared with strings.
+ */
+class StringRef
+{
+public:
+	/// Constructs empty reference.
+	StringRef() : ptr(""), length(0) {}
+
+	/// Constructs reference to given characters.
+	StringRef(const char * data, size_t size) : ptr(data), length(size) {}
+
+	/// Constructs reference to null terminated string.
+	StringRef(const char * str) : ptr(str), length(strlen(str)) {}
+
+	/// Constructs reference to contents of std::string.
+	StringRef(const std::string & str) : ptr(str.data()), length(str.size()) {}
+
+
+	/// Returns pointer to the first character. It isn't null terminated.
+	const char * data() const { return ptr; }
+
+	/// Returns number of characters.
+	size_t size() const { return length; }
+
+	/// Checks if there are no characters.
+	bool empty() const { return length == 0; }
+
+	/// Returns pointer to the first character.
+	const char * begin() const { return ptr; }
+
+	/// Returns pointer past the last character.
+	const char * end() const { return ptr + length; }
+
+	/// Returns character at given index.
+	char operator[](size_t index) const { return ptr[index]; }
+
+
+	/// Returns a copy as std::string.
+	std::string str() const { return std::string(ptr, length); }
+
+	/// Returns a copy as std::string.
+	operator std::string() const { return str(); }
+
+
+	/// Compares like std::string::compare().
+	int compare(const StringRef & other) const
+	{
+		int result = memcmp(ptr, other.ptr, length < other.length ? length : other.length);
+		if (result != 0)
+			return result;
+		return length < other.length ? -1 : (length > other.length ? 1 : 0);
+	}
+
+private:
+	const char * ptr;
+	size_t length;
+};
+
+///@cond PRIVATE
+inline bool operator==(const StringRef & a, const StringRef & b)
+{
+	return a.size() == b.size() && memcmp(a.data(), b.data(), a.size()) == 0;
+}
+
+inline bool operator!=(const StringRef & a, const StringRef & b)
+{
+	return !(a == b);
+}
+
+inline bool operator<(const StringRef & a, const StringRef & b)
+{
+	return a.compare(b) < 0;
+}
+
+inline std::ostream & operator<<(std::ostream & stream, const StringRef & str)
+{
+	return stream.write(str.data(), str.size());
+}
+///@endcond
+
+}
+
+#endif //_PPK_STRINGREF_HPP
@@ -0,0 +1,76 @@
+#include "StringTable.hpp"
+
+#include <cstring>
+
+using namespace ppk;
+using namespace ppk::detail;
+
+namespace
+{
+
+const size_t first_table_size = 64;
+
+}
+
+StringTable::Slots::Slots(size_t size) :
+    mask(size - 1),
+    entries(new std::atomic<const InternedString *>[size])
+{
+	for (size_t i = 0; i < size; i++)
+		entries[i].store(NULL, std::memory_order_relaxed);
+}
+
+StringTable::StringTable()
+{
+	tables.emplace_back(new Slots(first_table_size));
+	current.store(tables.back().get(), std::memory_order_release);
+}
+
+const InternedString * StringTable::intern(const StringRef & str)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	size_t hash = StringRefHash()(str), position;
+	Slots * slots = current.load(std::memory_order_relaxed);
+	if (const InternedString * found = lookup(*slots, str, hash, position))
+		return found;
+
+	strings.push_back(InternedString{str.str(), this});
+	const InternedString * interned = &strings.back();
+
+	if (2 * strings.size() <= slots->mask + 1)
+	{
+		// Published after it is constructed, for find() in other threads
+		slots->entries[position].store(interned, std::memory_order_release);
+		return interned;
+	}
+
+	// The new table is filled before it is published, so find() never sees it partially filled
+	tables.emplace_back(new Slots(2 * (slots->mask + 1)));
+	Slots * bigger = tables.back().get();
+	for (auto & string : strings)
+	{
+		lookup(*bigger, string.str, StringRefHash()(string.str), position);
+		bigger->entries[position].store(&string, std::memory_order_relaxed);
+	}
+	current.store(bigger, std::memory_order_release);
+	return interned;
+}
+
+const InternedString * StringTable::find(const StringRef & str) const
+{
+	size_t position;
+	return lookup(*current.load(std::memory_order_acquire), str, StringRefHash()(str), position);
+}
+
+const InternedString * StringTable::lookup(const Slots & slots, const StringRef & str, size_t hash, size_t & position)
+{
+	for (position = hash & slots.mask; ; position = (position + 1) & slots.mask)
+	{
+		const InternedString * entry = slots.entries[position].load(std::memory_order_acquire);
+		if (!entry)
+			return NULL;
+		if (entry->str.size() == str.size() && (str.empty() || memcmp(entry->str.data(), str.data(), str.size()) == 0))
+			return entry;
+	}
+}
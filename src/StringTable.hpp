@@ -0,0 +1,68 @@
+#ifndef _PPK_STRINGTABLE_HPP
+#define _PPK_STRINGTABLE_HPP
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "StringRef.hpp"
+#include "utility.hpp"
+
+
+namespace ppk
+{
+namespace detail
+{
+
+class StringTable;
+
+// Name or identifier of nodes, shared by all nodes of a tree using it
+struct InternedString
+{
+	std::string str;
+	StringTable * table;  // Owner, NULL if the string belongs to a single node
+};
+
+// Set of strings stored only once, so that they can be compared by address.
+// Strings live as long as the table.
+class StringTable
+{
+public:
+	StringTable();
+	StringTable(const StringTable &) = delete;
+	const StringTable & operator=(const StringTable &) = delete;
+
+	// Returns the string stored in the table, adding it if needed. Thread-safe.
+	const InternedString * intern(const StringRef & str);
+
+	// Returns NULL if there is no such string. Thread-safe and doesn't lock, so readers of a tree don't wait for each other.
+	const InternedString * find(const StringRef & str) const;
+
+private:
+	// Open addressing hash table of the strings. Slots are only ever filled, and a table which gets
+	// half full is replaced by a bigger one. Replaced tables are kept, as find() can still read them.
+	struct Slots
+	{
+		explicit Slots(size_t size);
+
+		size_t mask;  // Size minus one, sizes are powers of two
+		std::unique_ptr<std::atomic<const InternedString *>[]> entries;
+	};
+
+	std::deque<InternedString> strings;
+	std::vector<std::unique_ptr<Slots>> tables;  // The last one is current
+	std::atomic<Slots *> current;
+	std::mutex mutex;  // Held by intern()
+
+	// Returns the string, or NULL and the empty slot where it would be
+	static const InternedString * lookup(const Slots & slots, const StringRef & str, size_t hash, size_t & position);
+};
+
+}
+}
+
+
+#endif //_PPK_STRINGTABLE_HPP
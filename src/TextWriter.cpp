@@ -0,0 +1,330 @@
+#include "TextWriter.hpp"
+
+#include "Node.hpp"
+#include "PackedList.hpp"
+#include "Scanner.hpp"
+#include "TreeLayout.hpp"
+
+using namespace ppk;
+using namespace ppk::detail;
+
+namespace
+{
+
+const size_t buffer_size = 1 << 20;
+
+const unsigned char must_be_quoted = 1;
+const unsigned char must_be_escaped = 2;
+
+// What each character needs in a scalar, and letters of escape sequences
+struct EscapeTable
+{
+	unsigned char flags[256];
+	char sequences[256];
+
+	EscapeTable()
+	{
+		for (unsigned i = 0; i < 256; i++)
+		{
+			// Without quotes the scalar would end there
+			flags[i] = isScalarChar(static_cast<char>(i)) ? 0 : must_be_quoted;
+			sequences[i] = 0;
+		}
+
+		const char escaped[] = {'\\', '\b', '\n', '\r', '\t', '\"', '\''};
+		const char letters[] = {'\\', 'b', 'n', 'r', 't', '\"', '\''};
+		for (size_t i = 0; i < sizeof(escaped); i++)
+		{
+			unsigned char c = escaped[i];
+			flags[c] = must_be_quoted | must_be_escaped;
+			sequences[c] = letters[i];
+		}
+	}
+};
+
+const EscapeTable escape_table;
+
+}
+
+TextWriter::TextWriter(FILE * file) :
+    file(file),
+    stream(NULL),
+    buffer(&own_buffer),
+    failed(false),
+    compact(false),
+    open_end(false)
+{
+	own_buffer.reserve(buffer_size + 4096);
+}
+
+TextWriter::TextWriter(std::ostream & stream) :
+    file(NULL),
+    stream(&stream),
+    buffer(&own_buffer),
+    failed(false),
+    compact(false),
+    open_end(false)
+{
+	own_buffer.reserve(buffer_size + 4096);
+}
+
+TextWriter::TextWriter(std::string & output) :
+    file(NULL),
+    stream(NULL),
+    buffer(&output),
+    failed(false),
+    compact(false),
+    open_end(false)
+{
+}
+
+bool TextWriter::write(const std::vector<Node *> & nodes)
+{
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		putSeparator(Node::Type::Group, i, 0);
+		putHeader(nodes[i]->getName(), nodes[i]->getIdentifier(), nodes[i]->getType(), 0);
+		putContents(*nodes[i], 0);
+		flush();
+	}
+
+	flush(true);
+	return !failed;
+}
+
+bool TextWriter::write(const TreeLayout & layout)
+{
+	uint32_t first = layout.getFirstChild(0);
+	for (uint32_t i = 0; i < layout.child_counts[0]; i++)
+	{
+		uint32_t child = first + i;
+		putSeparator(Node::Type::Group, i, 0);
+		putHeader(layout.getString(layout.names[child]), layout.getString(layout.identifiers[child]),
+		          static_cast<Node::Type>(layout.getType(child)), 0);
+		putContents(layout, child, 0);
+		flush();
+	}
+
+	flush(true);
+	return !failed;
+}
+
+void TextWriter::setCompact(bool compact)
+{
+	this->compact = compact;
+}
+
+void TextWriter::putSeparator(Node::Type parent, size_t index, int d)
+{
+	if (compact)
+	{
+		// Nodes are separated only where the previous one could be continued
+		if (parent == Node::Type::List && d > 0)
+		{
+			if (index > 0)
+				*buffer += ',';
+		}
+		else if (open_end)
+			*buffer += ' ';
+		open_end = false;
+	}
+	else if (d == 0)
+		buffer->append("\n\n");
+	else if (parent == Node::Type::Group)
+		*buffer += '\n';
+	else if (index > 0)
+		buffer->append(",\n");
+}
+
+void TextWriter::putHeader(const StringRef & name, const StringRef & identifier, Node::Type type, int d)
+{
+	putIndent(d);
+
+	if (name.empty())
+		return;
+
+	putScalar(name);
+	if (!identifier.empty())
+	{
+		*buffer += ' ';
+		putScalar(identifier);
+	}
+
+	// Groups and Null nodes can follow the name straight away, as in a{b=1} and a;
+	if (!compact)
+		buffer->append(" = ");
+	else if (type == Node::Type::Scalar || type == Node::Type::List)
+		*buffer += '=';
+}
+
+void TextWriter::putContents(const Node & node, int d)
+{
+	switch (node.getType())
+	{
+	case Node::Type::Null:
+		buffer->append(compact ? ";" : "{}");
+		open_end = false;
+		break;
+
+	case Node::Type::Scalar:
+		putScalar(node.getScalar());
+		break;
+
+	case Node::Type::List:
+		putOpening(Node::Type::List);
+		if (node.size() > 0 && node.getPacked())
+		{
+			// Numbers never need quotes
+			const PackedList & packed = *node.getPacked();
+			char text[PackedList::text_size];
+			for (size_t i = 0; i < packed.size(); i++)
+			{
+				putSeparator(Node::Type::List, i, d + 1);
+				putIndent(d + 1);
+				buffer->append(text, packed.format(i, text));
+				flush();
+			}
+		}
+		else
+		{
+			for (unsigned i = 0; i < node.size(); i++)
+			{
+				putSeparator(Node::Type::List, i, d + 1);
+				putHeader(StringRef(), StringRef(), node[i].getType(), d + 1);
+				putContents(node[i], d + 1);
+				flush();
+			}
+		}
+		putClosing(Node::Type::List, d);
+		break;
+
+	case Node::Type::Group:
+		putOpening(Node::Type::Group);
+		for (auto & child : node.all())
+		{
+			putSeparator(Node::Type::Group, 0, d + 1);
+			putHeader(child.getName(), child.getIdentifier(), child.getType(), d + 1);
+			putContents(child, d + 1);
+			flush();
+		}
+		putClosing(Node::Type::Group, d);
+		break;
+	}
+}
+
+void TextWriter::putContents(const TreeLayout & layout, uint32_t index, int d)
+{
+	Node::Type type = static_cast<Node::Type>(layout.getType(index));
+	switch (type)
+	{
+	case Node::Type::Null:
+		buffer->append(compact ? ";" : "{}");
+		open_end = false;
+		break;
+
+	case Node::Type::Scalar:
+		putScalar(layout.getString(layout.values[index]));
+		break;
+
+	case Node::Type::List:
+	case Node::Type::Group:
+	{
+		// Children are next to each other, so they are written in the order of the arrays
+		putOpening(type);
+		uint32_t first = layout.getFirstChild(index);
+		for (uint32_t i = 0; i < layout.child_counts[index]; i++)
+		{
+			uint32_t child = first + i;
+			putSeparator(type, i, d + 1);
+			putHeader(layout.getString(layout.names[child]), layout.getString(layout.identifiers[child]),
+			          static_cast<Node::Type>(layout.getType(child)), d + 1);
+			putContents(layout, child, d + 1);
+			flush();
+		}
+		putClosing(type, d);
+		break;
+	}
+	}
+}
+
+void TextWriter::putOpening(Node::Type type)
+{
+	if (type == Node::Type::List)
+		buffer->append(compact ? "[" : "[\n");
+	else
+		*buffer += '{';
+	open_end = false;
+}
+
+void TextWriter::putClosing(Node::Type type, int d)
+{
+	if (!compact)
+	{
+		buffer->append(type == Node::Type::List ? "\n" : "\n\n");
+		putIndent(d);
+	}
+	*buffer += type == Node::Type::List ? ']' : '}';
+	open_end = false;
+}
+
+void TextWriter::putIndent(int d)
+{
+	if (!compact)
+		buffer->append(d, '\t');
+}
+
+void TextWriter::putScalar(const StringRef & str)
+{
+	// Empty scalars are quoted too, as nothing can't be read
+	unsigned char flags = str.empty() ? must_be_quoted : 0;
+	for (char c : str)
+		flags |= escape_table.flags[static_cast<unsigned char>(c)];
+
+	open_end = !(flags & must_be_quoted);
+	if (open_end)
+	{
+		buffer->append(str.data(), str.size());
+		return;
+	}
+
+	*buffer += '\"';
+	if (!(flags & must_be_escaped))
+	{
+		buffer->append(str.data(), str.size());
+	}
+	else
+	{
+		// Runs of characters without escape sequences are copied at once
+		const char * run = str.begin();
+		for (const char * p = str.begin(); p != str.end(); ++p)
+		{
+			char letter = escape_table.sequences[static_cast<unsigned char>(*p)];
+			if (!letter)
+				continue;
+
+			buffer->append(run, p);
+			*buffer += '\\';
+			*buffer += letter;
+			run = p + 1;
+		}
+		buffer->append(run, str.end());
+	}
+	*buffer += '\"';
+}
+
+bool TextWriter::hasFailed() const
+{
+	return failed;
+}
+
+void TextWriter::flush(bool force)
+{
+	if (buffer != &own_buffer || (buffer->size() < buffer_size && !force))
+		return;
+
+	if (file && fwrite(buffer->data(), 1, buffer->size(), file) != buffer->size())
+		failed = true;
+	if (stream && !stream->write(buffer->data(), buffer->size()))
+		failed = true;
+	buffer->clear();
+}
@@ -0,0 +1,69 @@
+#ifndef _PPK_TEXTWRITER_HPP
+#define _PPK_TEXTWRITER_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Node.hpp"
+#include "StringRef.hpp"
+
+
+namespace ppk
+{
+namespace detail
+{
+
+struct TreeLayout;
+
+// Writes nodes in text format of FS::write() through a buffer, to a file, a stream or the end of a string.
+// Strings are written straight to their end, without the buffer.
+class TextWriter
+{
+public:
+	TextWriter(FILE * file);
+	TextWriter(std::ostream & stream);
+	TextWriter(std::string & output);
+
+	// Compact text has no indentation and only the whitespaces the parser needs
+	void setCompact(bool compact);
+
+	// Writes the nodes as top-level ones. Returns false if writing failed.
+	bool write(const std::vector<Node *> & nodes);
+
+	// Writes children of the root of the layout as top-level nodes, going through its arrays.
+	// Throws std::runtime_error if the arrays are corrupted, see TreeLayout.
+	bool write(const TreeLayout & layout);
+
+	// Parts of the format, so that nodes can also be written one piece at a time.
+	// d is depth of the node, 0 for top-level ones.
+	void putSeparator(Node::Type parent, size_t index, int d);  // before index-th child
+	void putHeader(const StringRef & name, const StringRef & identifier, Node::Type type, int d);
+	void putContents(const Node & node, int d);
+	void putContents(const TreeLayout & layout, uint32_t index, int d);
+	void putOpening(Node::Type type);
+	void putClosing(Node::Type type, int d);
+
+	void flush(bool force = false);  // Writes the buffer if it is big enough
+	bool hasFailed() const;
+
+private:
+	FILE * file;
+	std::ostream * stream;
+	std::string own_buffer;
+	std::string * buffer;  // own_buffer, or the output string
+	bool failed;
+	bool compact;
+	bool open_end;  // The last scalar was written without quotes, so more characters would continue it
+
+	void putIndent(int d);
+	void putScalar(const StringRef & str);  // Quoted and escaped if needed
+};
+
+}
+}
+
+
+#endif //_PPK_TEXTWRITER_HPP
@@ -0,0 +1,151 @@
+#include "TreeBuilder.hpp"
+
+#include "LazyBody.hpp"
+#include "Node.hpp"
+#include "NodePool.hpp"
+#include "PackedList.hpp"
+#include "StringTable.hpp"
+
+using namespace ppk;
+using namespace ppk::detail;
+
+TreeBuilder::TreeBuilder(Node & owner, NodePool & pool, StringTable & table, const std::shared_ptr<const LazySource> & source) :
+    pool(pool),
+    table(table),
+    source(source),
+    stable_begin(NULL),
+    stable_end(NULL),
+    packing(false),
+    packed(false),
+    empty(table.intern(""))
+{
+	stack.push_back(&owner);
+}
+
+TreeBuilder::~TreeBuilder()
+{
+	// Nodes left after an error, and the owner
+	if (packed)
+		stack.pop_back();
+	else
+		current();
+	
+	for (auto & node : stack)
+		node->indexChildren();
+}
+
+void TreeBuilder::beginNode(const std::string & name, const std::string & identifier)
+{
+	Node * parent = current();
+	
+	// Empty lists, and lists with only packed elements so far
+	if (packing && name.empty() && identifier.empty() && parent->getIndex().empty()
+	    && (parent->type == Node::Type::Null || parent->type == Node::Type::List))
+	{
+		stack.push_back(NULL);
+		return;
+	}
+	
+	Node * node = pool.create(intern(name), intern(identifier));
+	parent->append(node);
+	stack.push_back(node);
+}
+
+void TreeBuilder::endNode()
+{
+	if (!packed)
+		current()->indexChildren();
+	stack.pop_back();
+	packed = false;
+}
+
+void TreeBuilder::continueAsList()
+{
+	Node * node = current();
+	
+	// The first value becomes a packed element, like the next ones
+	if (packing && node->type == Node::Type::Scalar)
+	{
+		std::unique_ptr<PackedList> list(new PackedList);
+		if (list->push(node->getScalar()))
+		{
+			node->reset();
+			node->type = Node::Type::List;
+			node->makeChildren().packed = list.release();
+			return;
+		}
+	}
+	
+	node->shake(pool.create(empty, empty));
+}
+
+void TreeBuilder::scalar(const StringRef & value)
+{
+	if (!stack.back())
+	{
+		Node * list = stack[stack.size() - 2];
+		PackedList *& packed_list = list->makeChildren().packed;
+		if (!packed_list)
+			packed_list = new PackedList;
+		
+		if (packed_list->push(value))
+		{
+			list->type = Node::Type::List;
+			packed = true;
+			return;
+		}
+	}
+	
+	bool stable = value.data() >= stable_begin && value.end() <= stable_end;
+	current()->assignScalar(value, !stable);
+}
+
+void TreeBuilder::referTo(const char * begin, const char * end)
+{
+	stable_begin = begin;
+	stable_end = end;
+}
+
+const InternedString * TreeBuilder::intern(const std::string & str)
+{
+	if (str.empty())
+		return empty;
+	
+	auto it = interned.find(str);
+	if (it != interned.end())
+		return it->second;
+	
+	const InternedString * result = table.intern(str);
+	interned.insert(std::make_pair(str, result));
+	return result;
+}
+
+Node * TreeBuilder::current()
+{
+	if (stack.back())
+		return stack.back();
+	
+	// Other elements become nodes too. A packed element is the last one then.
+	Node * list = stack[stack.size() - 2];
+	if (list->getPacked())
+		list->unpack();
+	
+	if (!packed)
+		list->append(pool.create(empty, empty));
+	
+	stack.back() = list->getIndex().back();
+	packed = false;
+	return stack.back();
+}
+
+void TreeBuilder::packLists()
+{
+	packing = true;
+}
+
+void TreeBuilder::defer(const char * from, const char * to)
+{
+	Node * node = current();
+	node->type = (*from == '{') ? Node::Type::Group : Node::Type::List;
+	node->makeChildren().body = new LazyBody{source, from, to, std::string()};
+}
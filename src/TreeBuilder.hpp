@@ -0,0 +1,71 @@
+#ifndef _PPK_TREEBUILDER_HPP
+#define _PPK_TREEBUILDER_HPP
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Handler.hpp"
+
+
+namespace ppk
+{
+
+class Node;
+
+namespace detail
+{
+
+struct LazySource;
+class NodePool;
+class StringTable;
+struct InternedString;
+
+// Handler building Node tree from parser's events. New nodes are created in the pool and added to the given owner,
+// their names and identifiers are interned in the table. If there is a source, contents of brackets in it can be deferred.
+class TreeBuilder : public Handler
+{
+public:
+	TreeBuilder(Node & owner, NodePool & pool, StringTable & table, const std::shared_ptr<const LazySource> & source = nullptr);
+	~TreeBuilder();
+
+	void beginNode(const std::string & name, const std::string & identifier) override;
+	void endNode() override;
+	void continueAsList() override;
+	void scalar(const StringRef & value) override;
+
+	// Scalars inside the range are referred to instead of copied, so it must outlive the nodes
+	void referTo(const char * begin, const char * end);
+	
+	// Gives the current node a group or list to be parsed later, from the opening bracket to after the closing one
+	void defer(const char * from, const char * to);
+	
+	// Lists of numbers are packed instead of made of nodes
+	void packLists();
+
+private:
+	std::vector<Node *> stack;
+	NodePool & pool;
+	StringTable & table;
+	std::shared_ptr<const LazySource> source;
+	const char * stable_begin;  // Range given to referTo(), empty by default
+	const char * stable_end;
+	bool packing;
+	bool packed;  // The current element was packed into its list
+	
+	// Strings interned so far, so that the table, shared with other threads, is rarely locked
+	std::unordered_map<std::string, const InternedString *> interned;
+	const InternedString * empty;
+	
+	const InternedString * intern(const std::string & str);
+	
+	// Returns the current node. Elements of lists which may be packed are NULL in the stack until they are needed.
+	Node * current();
+};
+
+}
+}
+
+
+#endif //_PPK_TREEBUILDER_HPP
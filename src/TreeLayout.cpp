@@ -0,0 +1,446 @@
+#include "TreeLayout.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "Node.hpp"
+#include "utility.hpp"
+
+using namespace ppk;
+using namespace ppk::detail;
+
+namespace
+{
+
+const char magic[] = {'P', 'P', 'K', 'I'};
+const uint32_t byte_order = 0x01020304;
+const uint32_t version = 1;
+
+// Beginning of image file. Sections are given as offsets from the beginning of the file, aligned to 8 bytes.
+struct ImageHeader
+{
+	char magic[4];
+	uint32_t byte_order;  // Images are not portable between machines of different endianness
+	uint32_t version;
+	uint32_t node_count;
+	uint32_t string_count;
+	uint32_t reserved;
+
+	uint64_t types;
+	uint64_t names;
+	uint64_t identifiers;
+	uint64_t parents;
+	uint64_t first_children;
+	uint64_t child_counts;
+	uint64_t values;
+	uint64_t sorted;
+	uint64_t string_offsets;
+	uint64_t strings;
+	uint64_t size;
+};
+
+uint64_t align(uint64_t offset)
+{
+	return (offset + 7) & ~uint64_t(7);
+}
+
+template <class T>
+bool writeSection(FILE * file, const T * data, size_t count, uint64_t & position)
+{
+	static const char padding[8] = {};
+	uint64_t aligned = align(position);
+
+	if (fwrite(padding, 1, aligned - position, file) != aligned - position)
+		return false;
+	if (count && fwrite(data, sizeof(T), count, file) != count)
+		return false;
+
+	position = aligned + sizeof(T) * count;
+	return true;
+}
+
+template <class T>
+bool getSection(const char * data, size_t size, uint64_t offset, uint64_t count, const T * & out)
+{
+	if (offset % 8 != 0 || offset > size || count > (size - offset) / sizeof(T))
+		return false;
+
+	out = reinterpret_cast<const T *>(data + offset);
+	return true;
+}
+
+// Checks all indices in the arrays at once, in one pass over them. Children come after their parent
+// and each of them has it as parent, so the ranges of children don't overlap and the tree has no cycles.
+bool checkLayout(const TreeLayout & layout)
+{
+	const uint64_t * offsets = layout.string_offsets;
+	uint64_t strings_size = offsets[layout.string_count];
+	if (offsets[0] != 0)
+		return false;
+	for (uint32_t i = 0; i < layout.string_count; i++)
+		if (offsets[i + 1] <= offsets[i] || offsets[i + 1] > strings_size || layout.strings[offsets[i + 1] - 1] != '\0')
+			return false;
+
+	if (layout.parents[0] != 0)
+		return false;
+	for (uint32_t i = 0; i < layout.node_count; i++)
+	{
+		if (layout.types[i] > static_cast<uint8_t>(Node::Type::Group) || layout.names[i] >= layout.string_count
+		    || layout.identifiers[i] >= layout.string_count || layout.values[i] >= layout.string_count
+		    || layout.parents[i] >= layout.node_count)
+			return false;
+
+		uint64_t first = layout.first_children[i], last = first + layout.child_counts[i];
+		if (last > layout.node_count || (first < last && first <= i))
+			return false;
+		for (uint64_t k = first; k < last; k++)
+			if (layout.parents[k] != i || layout.sorted[k] < first || layout.sorted[k] >= last)
+				return false;
+	}
+	return true;
+}
+
+}
+
+
+uint32_t TreeLayout::findString(const StringRef & str) const
+{
+	uint32_t first = 0, last = string_count;
+	while (first < last)
+	{
+		uint32_t middle = first + (last - first) / 2;
+		int result = getString(middle).compare(str);
+
+		if (result == 0)
+			return middle;
+		if (result < 0)
+			first = middle + 1;
+		else
+			last = middle;
+	}
+
+	return string_count;
+}
+
+
+TreeArrays::TreeArrays()
+{
+	build(Node());
+}
+
+void TreeArrays::build(const Node & root)
+{
+	// Breadth-first order puts children of every node next to each other.
+	std::vector<const Node *> nodes(1, &root);
+	parents.assign(1, 0);
+	first_children.clear();
+	child_counts.clear();
+
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		first_children.push_back(nodes.size());
+		child_counts.push_back(nodes[i]->size());
+
+		for (auto & child : nodes[i]->all())
+		{
+			nodes.push_back(&child);
+			parents.push_back(i);
+		}
+
+		if (nodes.size() > UINT32_MAX)
+			throw std::length_error("Too many nodes to be indexed with 32 bits!");
+	}
+
+	// Every string once, numbered in order of appearance
+	std::unordered_map<StringRef, uint32_t, StringRefHash> ids;
+	std::vector<StringRef> unique;
+	ids.reserve(nodes.size());
+	auto id = [&](const StringRef & str)
+	{
+		auto result = ids.insert(std::make_pair(str, unique.size()));
+		if (result.second)
+			unique.push_back(str);
+		return result.first->second;
+	};
+
+	id("");
+	types.resize(nodes.size());
+	names.resize(nodes.size());
+	identifiers.resize(nodes.size());
+	values.resize(nodes.size());
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		types[i] = static_cast<uint8_t>(nodes[i]->getType());
+		names[i] = id(nodes[i]->getName());
+		identifiers[i] = id(nodes[i]->getIdentifier());
+		values[i] = id(nodes[i]->getScalar());
+	}
+
+	std::vector<uint32_t> order = storeStrings(unique);
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		names[i] = order[names[i]];
+		identifiers[i] = order[identifiers[i]];
+		values[i] = order[values[i]];
+	}
+
+	sortChildren();
+}
+
+std::vector<uint32_t> TreeArrays::storeStrings(const std::vector<StringRef> & unique)
+{
+	// Strings are sorted, so that their indices can be compared instead of them.
+	std::vector<uint32_t> sorted_ids(unique.size());
+	for (size_t i = 0; i < unique.size(); i++)
+		sorted_ids[i] = i;
+	std::sort(sorted_ids.begin(), sorted_ids.end(), [&unique](uint32_t a, uint32_t b) { return unique[a] < unique[b]; });
+
+	std::vector<uint32_t> order(unique.size());
+	string_offsets.assign(1, 0);
+	strings.clear();
+	for (size_t i = 0; i < sorted_ids.size(); i++)
+	{
+		order[sorted_ids[i]] = i;
+		const StringRef & str = unique[sorted_ids[i]];
+		strings.append(str.data(), str.size());
+		strings += '\0';
+		string_offsets.push_back(strings.size());
+	}
+
+	return order;
+}
+
+void TreeArrays::sortChildren()
+{
+	size_t node_count = types.size();
+	sorted.resize(node_count);
+	sorted[0] = 0;
+	for (size_t i = 0; i < node_count; i++)
+	{
+		auto begin = sorted.begin() + first_children[i], end = begin + child_counts[i];
+		for (auto it = begin; it != end; ++it)
+			*it = it - sorted.begin();
+
+		std::stable_sort(begin, end, [this](uint32_t a, uint32_t b) { return names[a] < names[b]; });
+	}
+}
+
+
+TreeArrays::Builder::Builder()
+{
+	intern("");
+	records.push_back(Record{0, intern("<root>"), 0, 0, static_cast<uint8_t>(Node::Type::Null)});
+	stack.push_back(0);
+}
+
+void TreeArrays::Builder::beginNode(const std::string & name, const std::string & identifier)
+{
+	// Like in Node::append(), type of the parent depends on its first child
+	Record & parent = records[stack.back()];
+	if (parent.type == static_cast<uint8_t>(Node::Type::Null))
+		parent.type = static_cast<uint8_t>(name.empty() ? Node::Type::List : Node::Type::Group);
+
+	stack.push_back(add(Record{stack.back(), intern(name), intern(identifier), 0, static_cast<uint8_t>(Node::Type::Null)}));
+}
+
+void TreeArrays::Builder::endNode()
+{
+	stack.pop_back();
+}
+
+void TreeArrays::Builder::continueAsList()
+{
+	// Like in Node::shake(), the value moves to a new first element
+	uint32_t node = stack.back();
+	uint32_t element = add(Record{node, 0, 0, records[node].value, records[node].type});
+	for (size_t i = node + 1; i < element; i++)
+		if (records[i].parent == node)
+			records[i].parent = element;
+
+	records[node].value = 0;
+	records[node].type = static_cast<uint8_t>(Node::Type::List);
+}
+
+void TreeArrays::Builder::scalar(const StringRef & value)
+{
+	records[stack.back()].type = static_cast<uint8_t>(Node::Type::Scalar);
+	records[stack.back()].value = intern(value);
+}
+
+uint32_t TreeArrays::Builder::add(const Record & record)
+{
+	if (records.size() == UINT32_MAX)
+		throw std::length_error("Too many nodes to be indexed with 32 bits!");
+
+	records.push_back(record);
+	return records.size() - 1;
+}
+
+uint32_t TreeArrays::Builder::intern(const StringRef & str)
+{
+	auto it = ids.find(str);
+	if (it != ids.end())
+		return it->second;
+
+	strings.push_back(str);
+	ids.insert(std::make_pair(StringRef(strings.back()), strings.size() - 1));
+	return strings.size() - 1;
+}
+
+void TreeArrays::Builder::finish(TreeArrays & arrays) const
+{
+	// Children of every record, in chronological order
+	size_t count = records.size();
+	std::vector<uint32_t> child_offsets(count + 1, 0);
+	for (size_t i = 1; i < count; i++)
+		child_offsets[records[i].parent + 1]++;
+	for (size_t i = 0; i < count; i++)
+		child_offsets[i + 1] += child_offsets[i];
+
+	std::vector<uint32_t> children(count);
+	std::vector<uint32_t> filled(child_offsets.begin(), child_offsets.end() - 1);
+	for (size_t i = 1; i < count; i++)
+		children[filled[records[i].parent]++] = i;
+
+	// Breadth-first order, like in build()
+	std::vector<uint32_t> nodes(1, 0);
+	nodes.reserve(count);
+	arrays.parents.assign(1, 0);
+	arrays.first_children.clear();
+	arrays.child_counts.clear();
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		uint32_t record = nodes[i];
+		arrays.first_children.push_back(nodes.size());
+		arrays.child_counts.push_back(child_offsets[record + 1] - child_offsets[record]);
+
+		for (uint32_t k = child_offsets[record]; k < child_offsets[record + 1]; k++)
+		{
+			nodes.push_back(children[k]);
+			arrays.parents.push_back(i);
+		}
+	}
+
+	std::vector<StringRef> unique(strings.begin(), strings.end());
+	std::vector<uint32_t> order = arrays.storeStrings(unique);
+
+	arrays.types.resize(count);
+	arrays.names.resize(count);
+	arrays.identifiers.resize(count);
+	arrays.values.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		const Record & record = records[nodes[i]];
+		arrays.types[i] = record.type;
+		arrays.names[i] = order[record.name];
+		arrays.identifiers[i] = order[record.identifier];
+		arrays.values[i] = order[record.value];
+	}
+
+	arrays.sortChildren();
+}
+
+
+TreeLayout TreeArrays::getLayout() const
+{
+	TreeLayout layout;
+	layout.node_count = types.size();
+	layout.types = types.data();
+	layout.names = names.data();
+	layout.identifiers = identifiers.data();
+	layout.parents = parents.data();
+	layout.first_children = first_children.data();
+	layout.child_counts = child_counts.data();
+	layout.values = values.data();
+	layout.sorted = sorted.data();
+	layout.string_count = string_offsets.size() - 1;
+	layout.string_offsets = string_offsets.data();
+	layout.strings = strings.data();
+	return layout;
+}
+
+bool TreeArrays::write(FILE * file) const
+{
+	uint64_t node_count = types.size();
+
+	ImageHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, magic, sizeof(magic));
+	header.byte_order = byte_order;
+	header.version = version;
+	header.node_count = node_count;
+	header.string_count = string_offsets.size() - 1;
+
+	// Sections in the same order as in the header
+	uint64_t position = sizeof(ImageHeader);
+	uint64_t * offsets[] = {&header.types, &header.names, &header.identifiers, &header.parents, &header.first_children,
+	                        &header.child_counts, &header.values, &header.sorted, &header.string_offsets, &header.strings};
+	uint64_t sizes[] = {node_count, node_count * 4, node_count * 4, node_count * 4, node_count * 4,
+	                    node_count * 4, node_count * 4, node_count * 4, string_offsets.size() * 8, strings.size()};
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+	{
+		position = align(position);
+		*offsets[i] = position;
+		position += sizes[i];
+	}
+	header.size = position;
+
+	position = 0;
+	return writeSection(file, &header, 1, position)
+	    && writeSection(file, types.data(), types.size(), position)
+	    && writeSection(file, names.data(), names.size(), position)
+	    && writeSection(file, identifiers.data(), identifiers.size(), position)
+	    && writeSection(file, parents.data(), parents.size(), position)
+	    && writeSection(file, first_children.data(), first_children.size(), position)
+	    && writeSection(file, child_counts.data(), child_counts.size(), position)
+	    && writeSection(file, values.data(), values.size(), position)
+	    && writeSection(file, sorted.data(), sorted.size(), position)
+	    && writeSection(file, string_offsets.data(), string_offsets.size(), position)
+	    && writeSection(file, strings.data(), strings.size(), position);
+}
+
+
+bool detail::openImage(const char * data, size_t size, TreeLayout & layout, bool verify)
+{
+	if (size < sizeof(ImageHeader) || reinterpret_cast<uintptr_t>(data) % 8 != 0)
+		return false;
+
+	const ImageHeader & header = *reinterpret_cast<const ImageHeader *>(data);
+	if (memcmp(header.magic, magic, sizeof(magic)) != 0 || header.byte_order != byte_order
+	    || header.version != version || header.size != size || header.node_count == 0 || header.string_count == 0)
+		return false;
+
+	layout.node_count = header.node_count;
+	layout.string_count = header.string_count;
+
+	uint64_t nodes = header.node_count;
+	if (!getSection(data, size, header.types, nodes, layout.types)
+	    || !getSection(data, size, header.names, nodes, layout.names)
+	    || !getSection(data, size, header.identifiers, nodes, layout.identifiers)
+	    || !getSection(data, size, header.parents, nodes, layout.parents)
+	    || !getSection(data, size, header.first_children, nodes, layout.first_children)
+	    || !getSection(data, size, header.child_counts, nodes, layout.child_counts)
+	    || !getSection(data, size, header.values, nodes, layout.values)
+	    || !getSection(data, size, header.sorted, nodes, layout.sorted)
+	    || !getSection(data, size, header.string_offsets, uint64_t(header.string_count) + 1, layout.string_offsets))
+		return false;
+
+	uint64_t strings_size = layout.string_offsets[header.string_count];
+	if (!getSection(data, size, header.strings, strings_size, layout.strings))
+		return false;
+
+	return !verify || checkLayout(layout);
+}
+
+const TreeLayout & detail::emptyLayout()
+{
+	static const uint8_t types[] = {0};
+	static const uint32_t zero[] = {0};
+	static const uint32_t one[] = {1};
+	static const uint64_t string_offsets[] = {0, 1};
+
+	static const TreeLayout layout = {1, types, zero, zero, zero, one, zero, zero, zero, 1, string_offsets, ""};
+	return layout;
+}
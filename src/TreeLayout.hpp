@@ -0,0 +1,194 @@
+#ifndef _PPK_TREELAYOUT_HPP
+#define _PPK_TREELAYOUT_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Handler.hpp"
+#include "StringRef.hpp"
+#include "utility.hpp"
+
+
+namespace ppk
+{
+
+class Node;
+
+namespace detail
+{
+
+/*
+ * Tree stored in parallel arrays, one entry per node, addressed by 32-bit indices.
+ * Node 0 is the root. Children of every node are stored one after another, in
+ * chronological order, from first_children[i] to first_children[i] + child_counts[i].
+ * For such range, sorted contains the same children sorted by name, then chronologically.
+ *
+ * All strings (names, identifiers and scalars) are stored once, sorted, so comparing
+ * their indices is the same as comparing them. Each of them is followed by '\0'.
+ *
+ * Arrays of images are not checked when they are opened, unless it is asked for, so indices
+ * read from them are checked by the getters below. They throw std::runtime_error if an index
+ * is out of range, or if it would make a cycle, as children always come after their parent.
+ */
+struct TreeLayout
+{
+	uint32_t node_count;
+	const uint8_t * types;
+	const uint32_t * names;
+	const uint32_t * identifiers;
+	const uint32_t * parents;
+	const uint32_t * first_children;
+	const uint32_t * child_counts;
+	const uint32_t * values;  // Scalar of the node, 0 (empty string) if it isn't scalar
+	const uint32_t * sorted;
+
+	uint32_t string_count;
+	const uint64_t * string_offsets;  // string_count + 1 entries
+	const char * strings;
+
+	StringRef getString(uint32_t id) const;
+	uint8_t getType(uint32_t index) const;
+	uint32_t getParent(uint32_t index) const;
+	uint32_t getFirstChild(uint32_t index) const;
+	uint32_t getSorted(uint32_t parent, uint32_t position) const;  // Child at position in sorted
+
+	// Returns the index if it is index of a node
+	uint32_t checkNode(uint32_t index) const;
+
+	// Returns index of given string or string_count if there is no such
+	uint32_t findString(const StringRef & str) const;
+};
+
+inline void checkImage(bool valid)
+{
+	if (!valid)
+		throw std::runtime_error("The image is corrupted!");
+}
+
+inline StringRef TreeLayout::getString(uint32_t id) const
+{
+	checkImage(id < string_count);
+	uint64_t begin = string_offsets[id], end = string_offsets[id + 1];
+	checkImage(begin < end && end <= string_offsets[string_count]);
+	return StringRef(strings + begin, end - begin - 1);
+}
+
+inline uint8_t TreeLayout::getType(uint32_t index) const
+{
+	checkImage(types[index] <= 3);  // Node::Type::Group
+	return types[index];
+}
+
+inline uint32_t TreeLayout::getParent(uint32_t index) const
+{
+	uint32_t parent = parents[index];
+	checkImage(index == 0 ? parent == 0 : parent < index);
+	return parent;
+}
+
+inline uint32_t TreeLayout::getFirstChild(uint32_t index) const
+{
+	uint64_t first = first_children[index], count = child_counts[index];
+	checkImage(first + count <= node_count && (count == 0 || first > index));
+	return first;
+}
+
+inline uint32_t TreeLayout::getSorted(uint32_t parent, uint32_t position) const
+{
+	uint32_t first = getFirstChild(parent), child = sorted[position];
+	checkImage(child >= first && child - first < child_counts[parent]);
+	return child;
+}
+
+inline uint32_t TreeLayout::checkNode(uint32_t index) const
+{
+	checkImage(index < node_count);
+	return index;
+}
+
+
+// Owner of arrays of TreeLayout, built from Node tree or straight from parser's events
+class TreeArrays
+{
+public:
+	TreeArrays();
+
+	// @throws std::length_error if there are more nodes than 32-bit indices can address
+	void build(const Node & root);
+	TreeLayout getLayout() const;
+
+	// Writes the arrays to a file, in format that can be mapped by openImage()
+	bool write(FILE * file) const;
+
+	// Handler recording nodes in order of events, like TreeBuilder would add them, without making Nodes.
+	// The root is a node named <root>, like in FS.
+	class Builder : public Handler
+	{
+	public:
+		Builder();
+
+		void beginNode(const std::string & name, const std::string & identifier) override;
+		void endNode() override;
+		void continueAsList() override;
+		void scalar(const StringRef & value) override;
+
+		// Puts the recorded nodes into the arrays. @throws std::length_error like build()
+		void finish(TreeArrays & arrays) const;
+
+	private:
+		struct Record
+		{
+			uint32_t parent;
+			uint32_t name;  // Indices in strings
+			uint32_t identifier;
+			uint32_t value;
+			uint8_t type;
+		};
+
+		std::vector<Record> records;  // Parents are always before their children
+		std::vector<uint32_t> stack;
+		std::deque<std::string> strings;  // Every string once, in order of appearance
+		std::unordered_map<StringRef, uint32_t, StringRefHash> ids;
+
+		uint32_t add(const Record & record);  // returns its index
+		uint32_t intern(const StringRef & str);
+	};
+
+private:
+	std::vector<uint8_t> types;
+	std::vector<uint32_t> names;
+	std::vector<uint32_t> identifiers;
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> first_children;
+	std::vector<uint32_t> child_counts;
+	std::vector<uint32_t> values;
+	std::vector<uint32_t> sorted;
+
+	std::vector<uint64_t> string_offsets;
+	std::string strings;
+
+	// Stores the strings sorted and returns new index of each of them
+	std::vector<uint32_t> storeStrings(const std::vector<StringRef> & unique);
+
+	// Fills sorted from names, after the other arrays are filled
+	void sortChildren();
+};
+
+
+// Fills the layout with arrays of image in memory. Returns false if it isn't a valid image.
+// Only the header and bounds of the arrays are checked, unless verify is true, then also all indices in them.
+bool openImage(const char * data, size_t size, TreeLayout & layout, bool verify);
+
+// Layout of tree with only empty root
+const TreeLayout & emptyLayout();
+
+}
+}
+
+
+#endif //_PPK_TREELAYOUT_HPP
@@ -1,8 +1,16 @@
 #ifndef _PPK_UTILITY_HPP
 #define _PPK_UTILITY_HPP
 
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <exception>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <vector>
+
+#include "StringRef.hpp"
 
 
 namespace ppk
@@ -18,6 +26,80 @@ inline std::string to_string(const T& t)
 	return ss.str();
 }
 
+// Fast, non-cryptographic hash of memory contents
+inline uint64_t hashContents(const char * data, size_t size)
+{
+	const uint64_t multiplier = 0x9e3779b97f4a7c15ull;
+	uint64_t h = size * multiplier;
+	
+	for (; size >= 8; data += 8, size -= 8)
+	{
+		uint64_t word;
+		memcpy(&word, data, 8);
+		h = (h ^ word) * multiplier;
+		h ^= h >> 29;
+	}
+	
+	for (; size > 0; data++, size--)
+		h = (h ^ static_cast<unsigned char>(*data)) * multiplier;
+	
+	// Multiplying moves bits only upwards, so the high ones are folded into the low ones used by tables.
+	h ^= h >> 32;
+	h *= multiplier;
+	return h ^ (h >> 29);
+}
+
+struct StringRefHash
+{
+	size_t operator()(const StringRef & str) const
+	{
+		return hashContents(str.data(), str.size());
+	}
+};
+
+// Sets value to the smaller of it and given one
+inline void lowerTo(std::atomic<size_t> & value, size_t other)
+{
+	size_t current = value;
+	while (other < current && !value.compare_exchange_weak(current, other));
+}
+
+// Calls task(i) for every i < count, spreading the calls among given number of threads.
+// The first exception thrown by a task is rethrown after all threads finish.
+template <class Task>
+void parallelFor(size_t count, unsigned threads, Task task)
+{
+	std::atomic<size_t> next(0);
+	std::exception_ptr error;
+	std::atomic<bool> failed(false);
+	
+	auto worker = [&]()
+	{
+		try {
+			size_t i;
+			while (!failed && (i = next++) < count)
+				task(i);
+		}
+		catch (...)
+		{
+			if (!failed.exchange(true))
+				error = std::current_exception();
+		}
+	};
+	
+	std::vector<std::thread> pool;
+	for (unsigned i = 1; i < threads && i < count; i++)
+		pool.emplace_back(worker);
+	
+	worker();
+	
+	for (auto & thread : pool)
+		thread.join();
+	
+	if (error)
+		std::rethrow_exception(error);
+}
+
 }
 }
 